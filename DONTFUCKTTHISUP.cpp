@@ -6,10 +6,41 @@
 #include <iomanip>
 #include "json.hpp"
 #include <set>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include <charconv>
+#include <memory>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <tuple>
+#include <filesystem>
+#include <cstdio>
+#include <random>
+#include <string_view>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #define MAX_TRANSACTIONS 10000
 #define MAX_TOTAL_RECORDS 10000
 #define MAX_LIST_LIMIT 10000
+#define SEGMENT_ROWS 4096
+#define PARALLEL_SORT_MIN_CHUNK 1024
+#define INSERTION_SORT_THRESHOLD 24
+#define MIN_GALLOP 7
+#define BITMAP_ARRAY_MAX 4096
+#define BITMAP_WORDS 1024
+#define RANGE_TAIL_MIN 1024
+#define MICROS_PER_DAY 86400000000LL
+#define SKIP_LIST_MAX_LEVEL 16
+#define SKIP_LIST_SEED 20240601
+#define EXTERNAL_MERGE_FAN_IN 128 // runs merged at once, well under the usual open-file limit
+#define QUERY_INDEX_FRACTION 4 // a range index beats a scan below 1/4 of the rows
 
 using json = nlohmann::json;
 
@@ -19,11 +50,71 @@ struct BenchmarkResults {
     long long listSortTime = -1;
     long long arraySearchTime = -1;
     long long listSearchTime = -1;
+    long long indexSearchTime = -1; // same lookups through the store's hash index
 };
 
 // Declare global variable to store benchmark results from Option 2
 BenchmarkResults benchmark;
 
+// Every allocation made through operator new is counted here so benchmarks
+// can report how many heap allocations a code path performs
+std::atomic<size_t> heapAllocationCount(0);
+
+// Kept out of line: once inlined into library code GCC pairs malloc()/free()
+// with operator new/delete and raises a false -Wmismatched-new-delete
+#if defined(__GNUC__)
+#define NOINLINE __attribute__((noinline))
+#else
+#define NOINLINE
+#endif
+
+NOINLINE void *operator new(std::size_t bytes)
+{
+    heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(bytes ? bytes : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+NOINLINE void *operator new(std::size_t bytes, const std::nothrow_t &) noexcept
+{
+    heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(bytes ? bytes : 1);
+}
+
+// The array and nothrow forms are replaced too so every allocation is paired
+// with a matching free(); otherwise the library's own new/delete would be
+// mixed with ours (std::get_temporary_buffer uses nothrow new)
+NOINLINE void *operator new[](std::size_t bytes) { return ::operator new(bytes); }
+NOINLINE void *operator new[](std::size_t bytes, const std::nothrow_t &tag) noexcept
+{
+    return ::operator new(bytes, tag);
+}
+
+NOINLINE void operator delete(void *p) noexcept { std::free(p); }
+NOINLINE void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+NOINLINE void operator delete(void *p, const std::nothrow_t &) noexcept { std::free(p); }
+NOINLINE void operator delete[](void *p) noexcept { std::free(p); }
+NOINLINE void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+NOINLINE void operator delete[](void *p, const std::nothrow_t &) noexcept { std::free(p); }
+
+// How transaction_type sorts compare rows
+enum TypeSortMode
+{
+    TYPE_SORT_FOLD_PER_COMPARE, // fold both strings inside every comparison (compareIgnoreCase)
+    TYPE_SORT_PRECOMPUTED_KEY,  // fold each distinct value once into an integer rank
+    TYPE_SORT_RADIX             // stable LSD radix sort on the folded ranks
+};
+
+// Algorithm used by sortByLocation
+enum SortAlgorithm
+{
+    SORT_COMPARISON, // introsort on the array, merge sort on the list
+    SORT_RADIX,      // stable LSD radix sort on order-preserving dictionary ranks
+    SORT_ADAPTIVE,   // run-detecting natural merge sort, near O(n) on presorted input
+    SORT_PREFIX_KEY  // radix sort on 8-byte normalized string prefixes, full compare on ties
+};
+
 
 std::string toLower(const std::string &str)
 {
@@ -33,402 +124,4063 @@ std::string toLower(const std::string &str)
     return lowerStr;
 }
 
-struct Transaction
+// Bit counting helpers; compiler builtins where available
+#if defined(__GNUC__)
+inline int popcount64(uint64_t x) { return __builtin_popcountll(x); }
+inline int lowestBit64(uint64_t x) { return __builtin_ctzll(x); }
+#else
+inline int popcount64(uint64_t x)
 {
-    std::string transaction_id;
-    std::string timestamp;
-    std::string sender_account;
-    std::string receiver_account;
-    double amount;
-    std::string transaction_type;
-    std::string merchant_category;
-    std::string location;
-    std::string device_used;
-    bool is_fraud;
-    std::string fraud_type;
-    double time_since_last_transaction;
-    double spending_deviation_score;
-    double velocity_score;
-    double geo_anomaly_score;
-    std::string payment_channel;
-    std::string ip_address;
-    std::string device_hash;
-};
-
-struct Node
+    int n = 0;
+    for (; x; x &= x - 1)
+        ++n;
+    return n;
+}
+inline int lowestBit64(uint64_t x)
 {
-    Transaction *data;
-    Node *next;
-};
+    int n = 0;
+    for (; !(x & 1); x >>= 1)
+        ++n;
+    return n;
+}
+#endif
 
-class TransactionList
-{
-private:
-    Node *head;
-    Node *tail;
+inline unsigned char foldASCII(unsigned char ch) { return ch >= 'A' && ch <= 'Z' ? ch + ('a' - 'A') : ch; }
 
-    static Node *merge(Node *left, Node *right)
+// Three-way compare of two strings with ASCII letters folded to lower case,
+// ordering like toLower(a).compare(toLower(b)) but without building either
+// string. With SSE2, 16 bytes at a time are folded (A-Z gets 0x20 added) and
+// compared until the first differing byte.
+inline int compareIgnoreCase(std::string_view a, std::string_view b)
+{
+    size_t common = std::min(a.size(), b.size());
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i beforeA = _mm_set1_epi8('A' - 1), afterZ = _mm_set1_epi8('Z' + 1), caseBit = _mm_set1_epi8(0x20);
+    auto fold = [&](__m128i x)
     {
-        if (!left)
-            return right;
-        if (!right)
-            return left;
-
-        Node *result;
-        if (left->data->location < right->data->location)
-        {
-            result = left;
-            result->next = merge(left->next, right);
-        }
-        else
+        __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(x, beforeA), _mm_cmplt_epi8(x, afterZ));
+        return _mm_or_si128(x, _mm_and_si128(upper, caseBit));
+    };
+    for (; i + 16 <= common; i += 16)
+    {
+        __m128i x = fold(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a.data() + i)));
+        __m128i y = fold(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b.data() + i)));
+        unsigned differ = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y))) & 0xFFFFu;
+        if (differ)
         {
-            result = right;
-            result->next = merge(left, right->next);
+            i += lowestBit64(differ);
+            return foldASCII(a[i]) < foldASCII(b[i]) ? -1 : 1;
         }
-        return result;
     }
+#endif
+    for (; i < common; ++i)
+    {
+        unsigned char x = foldASCII(a[i]), y = foldASCII(b[i]);
+        if (x != y)
+            return x < y ? -1 : 1;
+    }
+    return a.size() < b.size() ? -1 : (a.size() > b.size() ? 1 : 0);
+}
+
+inline bool equalsIgnoreCase(std::string_view a, std::string_view b)
+{
+    return a.size() == b.size() && compareIgnoreCase(a, b) == 0;
+}
 
-    static void split(Node *source, Node **front, Node **back)
+// Parses "YYYY-MM-DD[Thh:mm[:ss[.ffffff]]]" (a space may replace the 'T')
+// into microseconds since 1970-01-01 UTC
+bool parseTimestamp(const std::string &text, int64_t &micros)
+{
+    int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+    int fraction = 0, fractionDigits = 0;
+    const char *p = text.c_str();
+
+    auto readNumber = [&p](int digits, int &out)
     {
-        Node *slow = source;
-        Node *fast = source->next;
+        out = 0;
+        for (int i = 0; i < digits; ++i, ++p)
+        {
+            if (*p < '0' || *p > '9')
+                return false;
+            out = out * 10 + (*p - '0');
+        }
+        return true;
+    };
 
-        while (fast)
+    if (!readNumber(4, year) || *p++ != '-' || !readNumber(2, month) || *p++ != '-' || !readNumber(2, day))
+        return false;
+    if (*p == 'T' || *p == ' ')
+    {
+        ++p;
+        if (!readNumber(2, hour) || *p++ != ':' || !readNumber(2, minute))
+            return false;
+        if (*p == ':')
         {
-            fast = fast->next;
-            if (fast)
+            ++p;
+            if (!readNumber(2, second))
+                return false;
+            if (*p == '.')
             {
-                slow = slow->next;
-                fast = fast->next;
+                ++p;
+                while (*p >= '0' && *p <= '9')
+                {
+                    if (fractionDigits < 6)
+                    {
+                        fraction = fraction * 10 + (*p - '0');
+                        ++fractionDigits;
+                    }
+                    ++p;
+                }
+                for (; fractionDigits < 6; ++fractionDigits)
+                    fraction *= 10;
             }
         }
-
-        *front = source;
-        *back = slow->next;
-        slow->next = nullptr;
     }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60)
+        return false;
 
-    static void mergeSort(Node **headRef)
-    {
-        Node *head = *headRef;
-        if (!head || !head->next)
-            return;
+    // Days since the epoch for a proleptic Gregorian date (Howard Hinnant's days_from_civil)
+    int y = year - (month <= 2);
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t days = static_cast<int64_t>(era) * 146097 + doe - 719468;
 
-        Node *a;
-        Node *b;
+    micros = ((days * 24 + hour) * 60 + minute) * 60 + second;
+    micros = micros * 1000000 + fraction;
+    return true;
+}
 
-        split(head, &a, &b);
-        mergeSort(&a);
-        mergeSort(&b);
+// ---- Memory accounting ----
+// Byte counts below model what the heap actually hands out rather than
+// sizeof(): glibc malloc adds an 8-byte header, rounds to 16 bytes and never
+// returns a chunk smaller than 32 bytes.
+size_t heapBlockBytes(size_t requested)
+{
+    if (requested == 0)
+        return 0;
+    size_t chunk = (requested + sizeof(size_t) + 15) & ~size_t(15);
+    return chunk < 32 ? 32 : chunk;
+}
 
-        *headRef = merge(a, b);
-    }
+// Heap buffer behind a std::string; zero when the value fits in the small-string buffer
+size_t stringHeapBytes(const std::string &str)
+{
+    const char *object = reinterpret_cast<const char *>(&str);
+    bool inline_ = str.data() >= object && str.data() < object + sizeof(std::string);
+    return inline_ ? 0 : heapBlockBytes(str.capacity() + 1);
+}
 
-public:
-    TransactionList() : head(nullptr), tail(nullptr) {}
+template <typename T>
+size_t vectorHeapBytes(const std::vector<T> &vec)
+{
+    return heapBlockBytes(vec.capacity() * sizeof(T));
+}
 
-    void append(Transaction *t)
+// Resident set size of this process from /proc/self/status, or 0 where unavailable
+size_t processResidentBytes()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
     {
-        Node *newNode = new Node{t, nullptr};
-        if (!head)
-        {
-            head = tail = newNode;
-        }
-        else
-        {
-            tail->next = newNode;
-            tail = newNode;
-        }
+        if (line.compare(0, 6, "VmRSS:") == 0)
+            return std::stoull(line.substr(6)) * 1024;
     }
+    return 0;
+}
 
-    void print(int limit = 20) const
+// Categorical columns that are dictionary-coded at load and can be partitioned on
+enum CategoricalColumn
+{
+    COL_TRANSACTION_TYPE,
+    COL_MERCHANT_CATEGORY,
+    COL_LOCATION,
+    COL_DEVICE_USED,
+    COL_FRAUD_TYPE,
+    COL_PAYMENT_CHANNEL,
+    CATEGORICAL_COLUMN_COUNT
+};
+
+const char *categoricalColumnName(CategoricalColumn column)
+{
+    switch (column)
     {
-        Node *temp = head;
-        int count = 0;
+    case COL_TRANSACTION_TYPE:
+        return "transaction_type";
+    case COL_MERCHANT_CATEGORY:
+        return "merchant_category";
+    case COL_LOCATION:
+        return "location";
+    case COL_DEVICE_USED:
+        return "device_used";
+    case COL_FRAUD_TYPE:
+        return "fraud_type";
+    case COL_PAYMENT_CHANNEL:
+        return "payment_channel";
+    default:
+        return "unknown";
+    }
+}
 
-        while (temp && count < limit)
+bool parseCategoricalColumn(const std::string &name, CategoricalColumn &column)
+{
+    std::string lowerName = toLower(name);
+    for (int c = 0; c < CATEGORICAL_COLUMN_COUNT; ++c)
+    {
+        if (lowerName == categoricalColumnName(static_cast<CategoricalColumn>(c)))
         {
-            std::cout << temp->data->transaction_id << "|"
-                      << temp->data->timestamp << "|"
-                      << temp->data->sender_account << "|"
-                      << temp->data->receiver_account << "|"
-                      << temp->data->amount << "|"
-                      << temp->data->payment_channel << "|"
-                      << temp->data->location << "\n";
-            temp = temp->next;
-            ++count;
+            column = static_cast<CategoricalColumn>(c);
+            return true;
         }
     }
+    return false;
+}
+
+// The four floating point measures carried by every transaction
+enum ScoreColumn
+{
+    SCORE_TIME_SINCE_LAST,
+    SCORE_SPENDING_DEVIATION,
+    SCORE_VELOCITY,
+    SCORE_GEO_ANOMALY,
+    SCORE_COLUMN_COUNT
+};
 
-    void sortByTransactionType()
+const char *scoreColumnName(ScoreColumn column)
+{
+    switch (column)
     {
-        mergeSortByType(&head);
+    case SCORE_TIME_SINCE_LAST:
+        return "time_since_last_transaction";
+    case SCORE_SPENDING_DEVIATION:
+        return "spending_deviation_score";
+    case SCORE_VELOCITY:
+        return "velocity_score";
+    default:
+        return "geo_anomaly_score";
     }
+}
 
-    static Node *mergeByType(Node *left, Node *right)
+bool parseScoreColumn(const std::string &name, ScoreColumn &column)
+{
+    std::string lowerName = toLower(name);
+    for (int c = 0; c < SCORE_COLUMN_COUNT; ++c)
     {
-        if (!left)
-            return right;
-        if (!right)
-            return left;
-
-        Node *result;
-        if (toLower(left->data->transaction_type) < toLower(right->data->transaction_type))
-        {
-            result = left;
-            result->next = mergeByType(left->next, right);
-        }
-        else
+        if (lowerName == scoreColumnName(static_cast<ScoreColumn>(c)))
         {
-            result = right;
-            result->next = mergeByType(left, right->next);
+            column = static_cast<ScoreColumn>(c);
+            return true;
         }
-        return result;
     }
+    return false;
+}
 
-    static void mergeSortByType(Node **headRef)
-    {
-        Node *head = *headRef;
-        if (!head || !head->next)
-            return;
+// How the numeric part of each transaction is held in memory
+enum StorageMode
+{
+    STORAGE_EXACT,   // double amount and scores, one byte per fraud flag
+    STORAGE_COMPACT  // int64 amount in minor units, float32 scores, fraud bitmap
+};
 
-        Node *a;
-        Node *b;
-        split(head, &a, &b);
-        mergeSortByType(&a);
-        mergeSortByType(&b);
-        *headRef = mergeByType(a, b);
-    }
+// Numeric fields as parsed from one CSV row, before they go into the store
+struct TransactionMetrics
+{
+    int64_t timestamp = 0;
+    double amount = 0.0;
+    bool is_fraud = false;
+    double scores[SCORE_COLUMN_COUNT] = {};
+};
 
-    void sortByLocation()
-    {
-        auto start = std::chrono::high_resolution_clock::now();
-        mergeSort(&head);
-        auto end = std::chrono::high_resolution_clock::now();
+// Hot part of a transaction: the fields that scans, sorts and searches touch.
+// Categorical values are dictionary codes; amount, timestamp, scores and the
+// fraud flag live in the store's dense NumericColumns under the same row id.
+struct Transaction
+{
+    uint32_t row_id;
+    uint32_t codes[CATEGORICAL_COLUMN_COUNT];
+};
 
-    }
+// Cold part: free-text fields that are only read to print or export a row
+struct TransactionDetails
+{
+    std::string transaction_id;
+    std::string timestamp;
+    std::string sender_account;
+    std::string receiver_account;
+    std::string ip_address;
+    std::string device_hash;
+};
 
+// Maps each distinct value of a column to a dense code (in first-seen order)
+// and keeps a running count per code so partitions can be sized without a scan.
+// The lower-cased form of each value is folded once, when it is first seen.
+class Dictionary
+{
+private:
+    std::vector<std::string> values;
+    std::vector<std::string> foldedValues;
+    std::vector<uint32_t> counts;
+    std::unordered_map<std::string, uint32_t> codes;
 
-    void jumpSearchTransactionType(const std::string &type) const
+public:
+    uint32_t encode(const std::string &value)
     {
-        std::string searchType = toLower(type);
-        int step = sqrt(countNodes());
-        Node *prev = nullptr;
-        Node *curr = head;
-        int i = 0;
-
-        while (curr && toLower(curr->data->transaction_type) < searchType)
+        auto it = codes.find(value);
+        if (it != codes.end())
         {
-            prev = curr;
-            for (int j = 0; j < step && curr; ++j)
-            {
-                curr = curr->next;
-                ++i;
-            }
+            ++counts[it->second];
+            return it->second;
         }
 
-        bool found = false;
-        while (prev && toLower(prev->data->transaction_type) <= searchType)
-        {
-            if (toLower(prev->data->transaction_type) == searchType)
-            {
-                std::cout << prev->data->transaction_id << " | "
-                          << prev->data->transaction_type << " | "
-                          << prev->data->location << "\n";
-                found = true;
-            }
-            prev = prev->next;
-        }
+        uint32_t code = static_cast<uint32_t>(values.size());
+        codes.emplace(value, code);
+        values.push_back(value);
+        foldedValues.push_back(toLower(value));
+        counts.push_back(1);
+        return code;
+    }
 
-        if (!found)
-            std::cout << "[INFO] No transactions found for type: " << type << "\n";
+    bool lookup(const std::string &value, uint32_t &code) const
+    {
+        auto it = codes.find(value);
+        if (it == codes.end())
+            return false;
+        code = it->second;
+        return true;
     }
 
-    int countNodes() const
+    // Rank of each code's value among the distinct values in sorted order, which
+    // makes the coding order-preserving: comparing ranks orders rows exactly
+    // like comparing the strings. With ignoreCase the folded values are ranked.
+    std::vector<uint32_t> sortedRanks(bool ignoreCase = false) const
     {
-        int count = 0;
-        Node *temp = head;
-        while (temp)
+        const std::vector<std::string> &folded = ignoreCase ? foldedValues : values;
+        std::vector<uint32_t> order(values.size());
+        for (uint32_t code = 0; code < values.size(); ++code)
+            order[code] = code;
+        std::sort(order.begin(), order.end(), [&folded](uint32_t a, uint32_t b)
+                  { return folded[a] < folded[b]; });
+
+        std::vector<uint32_t> ranks(values.size());
+        uint32_t rank = 0;
+        for (size_t i = 0; i < order.size(); ++i)
         {
-            ++count;
-            temp = temp->next;
+            if (i > 0 && folded[order[i]] != folded[order[i - 1]])
+                ++rank;
+            ranks[order[i]] = rank;
         }
-        return count;
+        return ranks;
     }
 
-    long long benchmarkSearch(const std::string &type) const
+    // Every code whose value matches `value` ignoring case ("Transfer" and "transfer")
+    std::vector<uint32_t> lookupIgnoreCase(const std::string &value) const
     {
-        std::string searchType = toLower(type);
-        auto start = std::chrono::high_resolution_clock::now();
-
-        Node *temp = head;
-        while (temp)
+        std::vector<uint32_t> matches;
+        for (uint32_t code = 0; code < values.size(); ++code)
         {
-            if (toLower(temp->data->transaction_type) == searchType)
-            {
-                volatile auto tmp = temp->data->amount;
-            }
-            temp = temp->next;
+            if (equalsIgnoreCase(values[code], value))
+                matches.push_back(code);
         }
-
-        auto end = std::chrono::high_resolution_clock::now();
-        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        return matches;
     }
 
-    ~TransactionList()
+    const std::string &decode(uint32_t code) const { return values[code]; }
+    const std::string &folded(uint32_t code) const { return foldedValues[code]; }
+    uint32_t count(uint32_t code) const { return counts[code]; }
+    uint32_t size() const { return static_cast<uint32_t>(values.size()); }
+
+    size_t memoryUsage() const
     {
-        Node *temp = head;
-        while (temp)
+        // unordered_map nodes hold the next pointer, the key/value pair and the cached hash
+        size_t mapNode = sizeof(void *) + sizeof(std::pair<const std::string, uint32_t>) + sizeof(size_t);
+        size_t total = vectorHeapBytes(values) + vectorHeapBytes(foldedValues) + vectorHeapBytes(counts) +
+                       heapBlockBytes(codes.bucket_count() * sizeof(void *)) +
+                       codes.size() * heapBlockBytes(mapNode);
+        for (uint32_t code = 0; code < values.size(); ++code)
         {
-            Node *toDelete = temp;
-            temp = temp->next;
-            delete toDelete->data;
-            delete toDelete;
+            // once in values, once as the map key, plus the folded copy
+            total += 2 * stringHeapBytes(values[code]) + stringHeapBytes(foldedValues[code]);
         }
+        return total;
     }
 };
 
-// Merge Sort for Linked List by Location****************
-Node *merge(Node *left, Node *right)
+// Hash index from a case-folded categorical value to the row ids holding it,
+// in row id order; "Transfer" and "transfer" share one posting list. Each new
+// dictionary code is mapped to the posting list of its folded value, so adding a
+// row is a vector lookup plus a push_back, and an equality lookup is one hash
+// probe plus the matches.
+class FoldedHashIndex
 {
-    if (!left)
-        return right;
-    if (!right)
-        return left;
+private:
+    std::unordered_map<std::string, uint32_t> postingOf; // folded value -> posting list
+    std::vector<uint32_t> postingOfCode;                  // dictionary code -> posting list
+    std::vector<std::vector<uint32_t>> postings;
 
-    Node *result;
-    if (left->data->location < right->data->location)
+public:
+    // `code` is the row's dictionary code and `folded` its lower-cased text;
+    // codes arrive in the order the dictionary hands them out
+    void add(uint32_t rowId, uint32_t code, const std::string &folded)
     {
-        result = left;
-        result->next = merge(left->next, right);
+        if (code == postingOfCode.size())
+        {
+            auto inserted = postingOf.emplace(folded, static_cast<uint32_t>(postings.size()));
+            if (inserted.second)
+                postings.emplace_back();
+            postingOfCode.push_back(inserted.first->second);
+        }
+        postings[postingOfCode[code]].push_back(rowId);
     }
-    else
+
+    // Row ids whose value equals `value` ignoring case
+    const std::vector<uint32_t> &lookup(const std::string &value) const
     {
-        result = right;
-        result->next = merge(left, right->next);
+        static const std::vector<uint32_t> none;
+        auto it = postingOf.find(toLower(value));
+        return it == postingOf.end() ? none : postings[it->second];
     }
-    return result;
-}
-
-// Splits list into two halves
-void split(Node *source, Node **front, Node **back)
-{
-    Node *slow = source;
-    Node *fast = source->next;
 
-    while (fast)
+    size_t memoryUsage() const
     {
-        fast = fast->next;
-        if (fast)
-        {
-            slow = slow->next;
-            fast = fast->next;
-        }
+        size_t mapNode = sizeof(void *) + sizeof(std::pair<const std::string, uint32_t>) + sizeof(size_t);
+        size_t total = heapBlockBytes(postingOf.bucket_count() * sizeof(void *)) +
+                       postingOf.size() * heapBlockBytes(mapNode) +
+                       vectorHeapBytes(postingOfCode) + vectorHeapBytes(postings);
+        for (const auto &entry : postingOf)
+            total += stringHeapBytes(entry.first);
+        for (const std::vector<uint32_t> &posting : postings)
+            total += vectorHeapBytes(posting);
+        return total;
     }
+};
 
-    *front = source;
-    *back = slow->next;
-    slow->next = nullptr;
-}
-
-// Recursive Merge Sort for Linked List
-void mergeSort(Node **headRef)
+enum BitmapOp
 {
-    Node *head = *headRef;
-    if (!head || !head->next)
-        return;
-
-    Node *a;
-    Node *b;
-
-    split(head, &a, &b);
-
-    mergeSort(&a);
-    mergeSort(&b);
-
-    *headRef = merge(a, b);
-}
-//////////////*********************************************** */
+    BITMAP_AND,
+    BITMAP_OR,
+    BITMAP_ANDNOT
+};
 
-class TransactionArray
+// Roaring-style compressed set of row ids. Ids are grouped by their high 16
+// bits into chunks; a chunk with at most BITMAP_ARRAY_MAX ids keeps their low
+// halves in a sorted array, a denser one is a 65536-bit bitset. Operations go
+// chunk by chunk: bitset against bitset is a plain word loop the compiler
+// vectorizes, anything involving an array chunk walks the array.
+class RowBitmap
 {
 private:
-    Transaction **data;
-    int size;
-    int capacity;
-
-public:
-    TransactionArray(int initialSize = MAX_TRANSACTIONS) : size(0), capacity(initialSize)
+    struct Chunk
     {
-        data = new Transaction *[capacity];
-    }
+        uint16_t key = 0;
+        uint32_t cardinality = 0;
+        std::vector<uint16_t> values; // sorted low halves while sparse
+        std::vector<uint64_t> words;  // BITMAP_WORDS words once dense
 
-    Transaction **getData() const { return data; }
-    int getSize() const { return size; }
+        bool dense() const { return !words.empty(); }
 
-    void insert(Transaction *t)
-    {
-        if (size == capacity)
+        bool contains(uint16_t low) const
         {
-            std::cerr << "[ERROR] Max array capacity reached. Aborting load.\n";
-            exit(EXIT_FAILURE);
+            if (dense())
+                return (words[low >> 6] >> (low & 63)) & 1;
+            return std::binary_search(values.begin(), values.end(), low);
         }
-        data[size++] = t;
-    }
-
-    void quickSort(int left, int right)
-    {
-        if (left >= right)
-            return;
-
-        std::string pivot = data[(left + right) / 2]->location;
-        int i = left;
-        int j = right;
 
-        while (i <= j)
+        void makeDense()
         {
-            while (data[i]->location < pivot)
-                i++;
-            while (data[j]->location > pivot)
-                j--;
+            words.assign(BITMAP_WORDS, 0);
+            for (uint16_t low : values)
+                words[low >> 6] |= uint64_t(1) << (low & 63);
+            std::vector<uint16_t>().swap(values);
+        }
 
-            if (i <= j)
+        // Recounts a bitset and turns it back into an array if it got sparse
+        void settle()
+        {
+            if (!dense())
             {
-                std::swap(data[i], data[j]);
-                i++;
-                j--;
+                cardinality = static_cast<uint32_t>(values.size());
+                if (cardinality > BITMAP_ARRAY_MAX)
+                    makeDense();
+                return;
+            }
+            cardinality = 0;
+            for (uint64_t word : words)
+                cardinality += popcount64(word);
+            if (cardinality > BITMAP_ARRAY_MAX)
+                return;
+            values.reserve(cardinality);
+            for (uint32_t w = 0; w < BITMAP_WORDS; ++w)
+            {
+                for (uint64_t bits = words[w]; bits; bits &= bits - 1)
+                    values.push_back(static_cast<uint16_t>(w * 64 + lowestBit64(bits)));
             }
+            std::vector<uint64_t>().swap(words);
         }
+    };
 
-        if (left < j)
-            quickSort(left, j);
-        if (i < right)
-            quickSort(i, right);
-    }
+    std::vector<Chunk> chunks; // ascending key, none empty
 
-    void print(int limit = 20) const
+    static Chunk combine(const Chunk &a, const Chunk &b, BitmapOp op)
     {
-        std::cout << "[INFO] Showing first " << limit << " sorted transactions:\n";
-        for (int i = 0; i < size && i < limit; ++i)
+        Chunk out;
+        out.key = a.key;
+        if (a.dense() && b.dense())
         {
-            std::cout << data[i]->transaction_id << " | "
-                      << data[i]->transaction_type << " | "
-                      << data[i]->timestamp << " | "
-                      << data[i]->sender_account << " | "
-                      << data[i]->receiver_account << " | "
-                      << data[i]->amount << " | "
-                      << data[i]->payment_channel << " | "
-                      << data[i]->location << "\n";
+            out.words.resize(BITMAP_WORDS);
+            const uint64_t *x = a.words.data(), *y = b.words.data();
+            uint64_t *z = out.words.data();
+            if (op == BITMAP_AND)
+                for (int w = 0; w < BITMAP_WORDS; ++w)
+                    z[w] = x[w] & y[w];
+            else if (op == BITMAP_OR)
+                for (int w = 0; w < BITMAP_WORDS; ++w)
+                    z[w] = x[w] | y[w];
+            else
+                for (int w = 0; w < BITMAP_WORDS; ++w)
+                    z[w] = x[w] & ~y[w];
         }
-    }
-
-    void sortByTransactionType()
-    {
-        std::sort(data, data + size, [](Transaction *a, Transaction *b)
-                  { return toLower(a->transaction_type) < toLower(b->transaction_type); });
-    }
-
-    void binarySearchTransactionType(const std::string &type) const
+        else if (!a.dense() && !b.dense())
+        {
+            auto into = std::back_inserter(out.values);
+            if (op == BITMAP_AND)
+                std::set_intersection(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(), into);
+            else if (op == BITMAP_OR)
+                std::set_union(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(), into);
+            else
+                std::set_difference(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(), into);
+        }
+        else if (op == BITMAP_OR)
+        {
+            const Chunk &sparse = a.dense() ? b : a;
+            out.words = (a.dense() ? a : b).words;
+            for (uint16_t low : sparse.values)
+                out.words[low >> 6] |= uint64_t(1) << (low & 63);
+        }
+        else if (!a.dense())
+        {
+            // array AND bitset keeps the members of b, array ANDNOT bitset drops them
+            for (uint16_t low : a.values)
+            {
+                if (b.contains(low) == (op == BITMAP_AND))
+                    out.values.push_back(low);
+            }
+        }
+        else if (op == BITMAP_AND)
+        {
+            for (uint16_t low : b.values)
+            {
+                if (a.contains(low))
+                    out.values.push_back(low);
+            }
+        }
+        else
+        {
+            out.words = a.words;
+            for (uint16_t low : b.values)
+                out.words[low >> 6] &= ~(uint64_t(1) << (low & 63));
+        }
+        out.settle();
+        return out;
+    }
+
+public:
+    // Adds a row id larger than every id already present, as the store does at load
+    void append(uint32_t rowId)
+    {
+        uint16_t key = static_cast<uint16_t>(rowId >> 16), low = static_cast<uint16_t>(rowId & 0xFFFF);
+        if (chunks.empty() || chunks.back().key != key)
+        {
+            chunks.emplace_back();
+            chunks.back().key = key;
+        }
+        Chunk &chunk = chunks.back();
+        if (chunk.dense())
+            chunk.words[low >> 6] |= uint64_t(1) << (low & 63);
+        else
+        {
+            chunk.values.push_back(low);
+            if (chunk.values.size() > BITMAP_ARRAY_MAX)
+                chunk.makeDense();
+        }
+        ++chunk.cardinality;
+    }
+
+    static RowBitmap fromSorted(const std::vector<uint32_t> &rowIds)
+    {
+        RowBitmap rows;
+        for (uint32_t rowId : rowIds)
+            rows.append(rowId);
+        return rows;
+    }
+
+    // Every row id below `count`
+    static RowBitmap range(uint32_t count)
+    {
+        RowBitmap all;
+        for (uint32_t rowId = 0; rowId < count; ++rowId)
+            all.append(rowId);
+        return all;
+    }
+
+    // Walks the chunks of both sides in key order; AND keeps shared keys only,
+    // OR passes unshared chunks through, ANDNOT keeps those of the left side
+    RowBitmap apply(const RowBitmap &other, BitmapOp op) const
+    {
+        RowBitmap result;
+        size_t i = 0, j = 0;
+        while (i < chunks.size() || j < other.chunks.size())
+        {
+            bool left = j == other.chunks.size() || (i < chunks.size() && chunks[i].key < other.chunks[j].key);
+            bool right = i == chunks.size() || (j < other.chunks.size() && other.chunks[j].key < chunks[i].key);
+            if (left)
+            {
+                if (op != BITMAP_AND)
+                    result.chunks.push_back(chunks[i]);
+                ++i;
+            }
+            else if (right)
+            {
+                if (op == BITMAP_OR)
+                    result.chunks.push_back(other.chunks[j]);
+                ++j;
+            }
+            else
+            {
+                Chunk chunk = combine(chunks[i++], other.chunks[j++], op);
+                if (chunk.cardinality)
+                    result.chunks.push_back(std::move(chunk));
+            }
+        }
+        return result;
+    }
+
+    RowBitmap intersect(const RowBitmap &other) const { return apply(other, BITMAP_AND); }
+    RowBitmap unite(const RowBitmap &other) const { return apply(other, BITMAP_OR); }
+    RowBitmap subtract(const RowBitmap &other) const { return apply(other, BITMAP_ANDNOT); }
+
+    bool contains(uint32_t rowId) const
+    {
+        uint16_t key = static_cast<uint16_t>(rowId >> 16);
+        auto it = std::lower_bound(chunks.begin(), chunks.end(), key,
+                                   [](const Chunk &chunk, uint16_t k) { return chunk.key < k; });
+        return it != chunks.end() && it->key == key && it->contains(static_cast<uint16_t>(rowId & 0xFFFF));
+    }
+
+    uint32_t cardinality() const
+    {
+        uint32_t total = 0;
+        for (const Chunk &chunk : chunks)
+            total += chunk.cardinality;
+        return total;
+    }
+
+    bool empty() const { return chunks.empty(); }
+
+    // Calls `visit` with every row id in ascending order
+    template <typename Visit>
+    void forEach(Visit visit) const
+    {
+        for (const Chunk &chunk : chunks)
+        {
+            uint32_t high = uint32_t(chunk.key) << 16;
+            if (!chunk.dense())
+            {
+                for (uint16_t low : chunk.values)
+                    visit(high | low);
+                continue;
+            }
+            for (uint32_t w = 0; w < BITMAP_WORDS; ++w)
+            {
+                for (uint64_t bits = chunk.words[w]; bits; bits &= bits - 1)
+                    visit(high | (w * 64 + lowestBit64(bits)));
+            }
+        }
+    }
+
+    // The members for which `keep(rowId)` holds
+    template <typename Keep>
+    RowBitmap filter(Keep keep) const
+    {
+        RowBitmap kept;
+        forEach([&](uint32_t rowId)
+                {
+                    if (keep(rowId))
+                        kept.append(rowId); });
+        return kept;
+    }
+
+    std::vector<uint32_t> toRowIds() const
+    {
+        std::vector<uint32_t> rowIds;
+        rowIds.reserve(cardinality());
+        forEach([&rowIds](uint32_t rowId) { rowIds.push_back(rowId); });
+        return rowIds;
+    }
+
+    size_t memoryUsage() const
+    {
+        size_t total = vectorHeapBytes(chunks);
+        for (const Chunk &chunk : chunks)
+            total += vectorHeapBytes(chunk.values) + vectorHeapBytes(chunk.words);
+        return total;
+    }
+};
+
+// Ordered index of (key, row id) pairs for range queries on one int64 column.
+// The bulk lives in a sorted array searched through an Eytzinger (BFS order)
+// copy of its keys, so the first levels of every lookup share cache lines.
+// Appends go unsorted to a small tail that is sorted once, merged in and the
+// Eytzinger copy rebuilt when it outgrows RANGE_TAIL_MIN or a sixteenth of the
+// bulk; a query that finds the tail unsorted sorts it first.
+// Matches come out in key order, ties in row id order.
+class RangeIndex
+{
+private:
+    std::vector<int64_t> keys;
+    std::vector<uint32_t> rowIds;
+    std::vector<int64_t> eytzinger;      // 1-based BFS layout of keys
+    std::vector<uint32_t> eytzingerRank; // position in keys of each eytzinger slot
+    mutable std::vector<std::pair<int64_t, uint32_t>> tail; // (key, row id)
+    mutable bool tailSorted = true;
+
+    size_t fillEytzinger(size_t next, size_t slot)
+    {
+        if (slot < eytzinger.size())
+        {
+            next = fillEytzinger(next, 2 * slot);
+            eytzinger[slot] = keys[next];
+            eytzingerRank[slot] = static_cast<uint32_t>(next++);
+            next = fillEytzinger(next, 2 * slot + 1);
+        }
+        return next;
+    }
+
+    void sortTail() const
+    {
+        if (!tailSorted)
+        {
+            std::sort(tail.begin(), tail.end());
+            tailSorted = true;
+        }
+    }
+
+    // Tail rows always have higher row ids than the bulk, so bulk rows win ties
+    void mergeTail()
+    {
+        sortTail();
+        std::vector<int64_t> mergedKeys(keys.size() + tail.size());
+        std::vector<uint32_t> mergedRowIds(mergedKeys.size());
+        size_t i = 0, j = 0;
+        for (size_t out = 0; out < mergedKeys.size(); ++out)
+        {
+            bool fromTail = i == keys.size() || (j < tail.size() && tail[j].first < keys[i]);
+            mergedKeys[out] = fromTail ? tail[j].first : keys[i];
+            mergedRowIds[out] = fromTail ? tail[j++].second : rowIds[i++];
+        }
+        keys.swap(mergedKeys);
+        rowIds.swap(mergedRowIds);
+        tail.clear();
+
+        eytzinger.assign(keys.size() + 1, 0);
+        eytzingerRank.assign(keys.size() + 1, 0);
+        fillEytzinger(0, 1);
+    }
+
+    // First position in keys whose key is >= `key`. The descent always takes
+    // the same number of steps; the final slot is recovered by dropping the
+    // trailing right turns taken after the answer was passed.
+    size_t lowerBound(int64_t key) const
+    {
+        size_t slot = 1;
+        while (slot < eytzinger.size())
+            slot = 2 * slot + (eytzinger[slot] < key);
+        slot >>= lowestBit64(~static_cast<uint64_t>(slot)) + 1;
+        return slot == 0 ? keys.size() : eytzingerRank[slot];
+    }
+
+public:
+    void append(int64_t key, uint32_t rowId)
+    {
+        if (!tail.empty() && key < tail.back().first)
+            tailSorted = false;
+        tail.emplace_back(key, rowId);
+        if (tail.size() > std::max<size_t>(RANGE_TAIL_MIN, keys.size() / 16))
+            mergeTail();
+    }
+
+    uint32_t size() const { return static_cast<uint32_t>(keys.size() + tail.size()); }
+
+    // Number of rows with lo <= key <= hi
+    uint32_t count(int64_t lo, int64_t hi) const
+    {
+        if (lo > hi)
+            return 0;
+        size_t mainCount = (hi == INT64_MAX ? keys.size() : lowerBound(hi + 1)) - lowerBound(lo);
+        sortTail();
+        auto tailFirst = std::lower_bound(tail.begin(), tail.end(), std::make_pair(lo, uint32_t(0)));
+        auto tailLast = std::upper_bound(tailFirst, tail.end(), std::make_pair(hi, UINT32_MAX));
+        return static_cast<uint32_t>(mainCount + (tailLast - tailFirst));
+    }
+
+    // Calls `visit(rowId, key)` for every row with lo <= key <= hi, in key order
+    template <typename Visit>
+    void forEachInRange(int64_t lo, int64_t hi, Visit visit) const
+    {
+        if (lo > hi)
+            return;
+        size_t i = lowerBound(lo);
+        sortTail();
+        size_t j = std::lower_bound(tail.begin(), tail.end(), std::make_pair(lo, uint32_t(0))) - tail.begin();
+        while (true)
+        {
+            bool mainLeft = i < keys.size() && keys[i] <= hi;
+            bool tailLeft = j < tail.size() && tail[j].first <= hi;
+            if (!mainLeft && !tailLeft)
+                break;
+            if (mainLeft && (!tailLeft || keys[i] <= tail[j].first))
+            {
+                visit(rowIds[i], keys[i]);
+                ++i;
+            }
+            else
+            {
+                visit(tail[j].second, tail[j].first);
+                ++j;
+            }
+        }
+    }
+
+    std::vector<uint32_t> rangeRowIds(int64_t lo, int64_t hi) const
+    {
+        std::vector<uint32_t> matches;
+        matches.reserve(count(lo, hi));
+        forEachInRange(lo, hi, [&matches](uint32_t rowId, int64_t) { matches.push_back(rowId); });
+        return matches;
+    }
+
+    size_t memoryUsage() const
+    {
+        return vectorHeapBytes(keys) + vectorHeapBytes(rowIds) + vectorHeapBytes(eytzinger) +
+               vectorHeapBytes(eytzingerRank) + vectorHeapBytes(tail);
+    }
+};
+
+// Widens a float32 score to the double with the shortest decimal form that
+// round-trips, so 0.0907f prints and exports as 0.0907 rather than 0.09070000052
+double widenScore(float value)
+{
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    double widened = value;
+    std::from_chars(buffer, result.ptr, widened);
+    return widened;
+}
+
+// Column-wise numeric storage indexed by row id. In compact mode the amount is
+// kept exactly as int64 minor units (cents), the scores drop to float32 and the
+// fraud flags are packed 64 to a word.
+class NumericColumns
+{
+private:
+    StorageMode mode;
+    uint32_t count;
+
+    std::vector<int64_t> timestamps;
+    std::vector<double> exactAmounts;
+    std::vector<double> exactScores[SCORE_COLUMN_COUNT];
+    std::vector<uint8_t> exactFraud;
+
+    std::vector<int64_t> amountMinor;
+    std::vector<float> compactScores[SCORE_COLUMN_COUNT];
+    std::vector<uint64_t> fraudBits;
+
+public:
+    explicit NumericColumns(StorageMode mode = STORAGE_EXACT) : mode(mode), count(0) {}
+
+    StorageMode getMode() const { return mode; }
+
+    void append(const TransactionMetrics &m)
+    {
+        timestamps.push_back(m.timestamp);
+        if (mode == STORAGE_EXACT)
+        {
+            exactAmounts.push_back(m.amount);
+            for (int c = 0; c < SCORE_COLUMN_COUNT; ++c)
+                exactScores[c].push_back(m.scores[c]);
+            exactFraud.push_back(m.is_fraud ? 1 : 0);
+        }
+        else
+        {
+            amountMinor.push_back(std::llround(m.amount * 100.0));
+            for (int c = 0; c < SCORE_COLUMN_COUNT; ++c)
+                compactScores[c].push_back(static_cast<float>(m.scores[c]));
+            if (count % 64 == 0)
+                fraudBits.push_back(0);
+            if (m.is_fraud)
+                fraudBits[count / 64] |= uint64_t(1) << (count % 64);
+        }
+        ++count;
+    }
+
+    int64_t timestamp(uint32_t row) const { return timestamps[row]; }
+
+    double amount(uint32_t row) const
+    {
+        return mode == STORAGE_EXACT ? exactAmounts[row] : amountMinor[row] / 100.0;
+    }
+
+    // Amount in cents; exact in compact mode, rounded from the double otherwise.
+    // Use this for sums and equality so both modes agree to the cent.
+    int64_t amountMinorUnits(uint32_t row) const
+    {
+        return mode == STORAGE_EXACT ? std::llround(exactAmounts[row] * 100.0) : amountMinor[row];
+    }
+
+    double score(ScoreColumn column, uint32_t row) const
+    {
+        return mode == STORAGE_EXACT ? exactScores[column][row] : compactScores[column][row];
+    }
+
+    // Score as it should appear in print and export output
+    double displayScore(ScoreColumn column, uint32_t row) const
+    {
+        return mode == STORAGE_EXACT ? exactScores[column][row] : widenScore(compactScores[column][row]);
+    }
+
+    bool isFraud(uint32_t row) const
+    {
+        if (mode == STORAGE_EXACT)
+            return exactFraud[row] != 0;
+        return (fraudBits[row / 64] >> (row % 64)) & 1;
+    }
+
+    uint32_t size() const { return count; }
+
+    size_t bytesUsed() const
+    {
+        if (mode == STORAGE_EXACT)
+            return exactBytes(count);
+        return count * (2 * sizeof(int64_t) + SCORE_COLUMN_COUNT * sizeof(float)) +
+               fraudBits.size() * sizeof(uint64_t);
+    }
+
+    size_t memoryUsage() const
+    {
+        size_t total = vectorHeapBytes(timestamps) + vectorHeapBytes(exactAmounts) +
+                       vectorHeapBytes(exactFraud) + vectorHeapBytes(amountMinor) + vectorHeapBytes(fraudBits);
+        for (int c = 0; c < SCORE_COLUMN_COUNT; ++c)
+            total += vectorHeapBytes(exactScores[c]) + vectorHeapBytes(compactScores[c]);
+        return total;
+    }
+
+    // What the same rows cost in exact mode, for reporting the compact saving
+    static size_t exactBytes(uint32_t rows)
+    {
+        return rows * (sizeof(int64_t) + sizeof(double) + SCORE_COLUMN_COUNT * sizeof(double) + sizeof(uint8_t));
+    }
+};
+
+// Summary of one segment (SEGMENT_ROWS consecutive row ids) used to skip it
+// during scans: numeric min/max plus a bitset of the dictionary codes present
+struct SegmentZoneMap
+{
+    uint32_t firstRow = 0;
+    uint32_t rowCount = 0;
+    double minAmount = 0.0, maxAmount = 0.0;
+    int64_t minTimestamp = 0, maxTimestamp = 0;
+    double minScore[SCORE_COLUMN_COUNT] = {};
+    double maxScore[SCORE_COLUMN_COUNT] = {};
+    std::vector<uint64_t> presentCodes[CATEGORICAL_COLUMN_COUNT];
+
+    void include(const Transaction *t, const NumericColumns &numbers)
+    {
+        uint32_t row = t->row_id;
+        double amount = numbers.amount(row);
+        int64_t timestamp = numbers.timestamp(row);
+        bool first = rowCount == 0;
+
+        minAmount = first ? amount : std::min(minAmount, amount);
+        maxAmount = first ? amount : std::max(maxAmount, amount);
+        minTimestamp = first ? timestamp : std::min(minTimestamp, timestamp);
+        maxTimestamp = first ? timestamp : std::max(maxTimestamp, timestamp);
+        for (int c = 0; c < SCORE_COLUMN_COUNT; ++c)
+        {
+            double score = numbers.score(static_cast<ScoreColumn>(c), row);
+            minScore[c] = first ? score : std::min(minScore[c], score);
+            maxScore[c] = first ? score : std::max(maxScore[c], score);
+        }
+        for (int c = 0; c < CATEGORICAL_COLUMN_COUNT; ++c)
+        {
+            uint32_t code = t->codes[c];
+            if (presentCodes[c].size() <= code / 64)
+                presentCodes[c].resize(code / 64 + 1, 0);
+            presentCodes[c][code / 64] |= uint64_t(1) << (code % 64);
+        }
+        ++rowCount;
+    }
+
+    bool hasCode(CategoricalColumn column, uint32_t code) const
+    {
+        return code / 64 < presentCodes[column].size() &&
+               ((presentCodes[column][code / 64] >> (code % 64)) & 1);
+    }
+
+    size_t memoryUsage() const
+    {
+        size_t total = 0;
+        for (int c = 0; c < CATEGORICAL_COLUMN_COUNT; ++c)
+            total += vectorHeapBytes(presentCodes[c]);
+        return total;
+    }
+};
+
+// Open-addressing (linear probing) hash table from transaction_id to row id.
+// A slot is the row id plus the high half of the key's hash, so a probe only
+// compares strings when those 32 bits agree; the ids themselves stay in the
+// store's details. Kept at most half full, doubling as the store grows. If an
+// id repeats, lookups return its first row.
+class TransactionIdIndex
+{
+private:
+    struct Slot
+    {
+        uint32_t rowId = UINT32_MAX; // UINT32_MAX marks an empty slot
+        uint32_t tag = 0;
+    };
+    std::vector<Slot> slots; // power-of-two size
+    uint32_t used = 0;
+
+    static uint64_t hashOf(const std::string &id) { return std::hash<std::string>()(id); }
+
+    void grow(const std::vector<TransactionDetails> &details)
+    {
+        std::vector<Slot> old;
+        old.swap(slots);
+        slots.assign(old.empty() ? 1024 : old.size() * 2, Slot());
+        for (const Slot &slot : old)
+        {
+            if (slot.rowId == UINT32_MAX)
+                continue;
+            size_t at = hashOf(details[slot.rowId].transaction_id) & (slots.size() - 1);
+            while (slots[at].rowId != UINT32_MAX)
+                at = (at + 1) & (slots.size() - 1);
+            slots[at] = slot;
+        }
+    }
+
+public:
+    // `details` must already hold the row
+    void add(uint32_t rowId, const std::vector<TransactionDetails> &details)
+    {
+        if (2 * (used + 1) > slots.size())
+            grow(details);
+        uint64_t hash = hashOf(details[rowId].transaction_id);
+        size_t at = hash & (slots.size() - 1);
+        while (slots[at].rowId != UINT32_MAX)
+            at = (at + 1) & (slots.size() - 1);
+        slots[at].rowId = rowId;
+        slots[at].tag = static_cast<uint32_t>(hash >> 32);
+        ++used;
+    }
+
+    // Row id of `id`, or UINT32_MAX when no row has it
+    uint32_t find(const std::string &id, const std::vector<TransactionDetails> &details) const
+    {
+        if (slots.empty())
+            return UINT32_MAX;
+        uint64_t hash = hashOf(id);
+        uint32_t tag = static_cast<uint32_t>(hash >> 32);
+        for (size_t at = hash & (slots.size() - 1); slots[at].rowId != UINT32_MAX; at = (at + 1) & (slots.size() - 1))
+        {
+            if (slots[at].tag == tag && details[slots[at].rowId].transaction_id == id)
+                return slots[at].rowId;
+        }
+        return UINT32_MAX;
+    }
+
+    double loadFactor() const { return slots.empty() ? 0.0 : static_cast<double>(used) / slots.size(); }
+    size_t memoryUsage() const { return vectorHeapBytes(slots); }
+};
+
+// Columns with an ordered RangeIndex. Amounts are keyed in cents, timestamps
+// in microseconds and time of day in microseconds since midnight (UTC).
+enum RangeColumn
+{
+    RANGE_AMOUNT,
+    RANGE_TIMESTAMP,
+    RANGE_TIME_OF_DAY,
+    RANGE_COLUMN_COUNT
+};
+
+// Heap bytes held by the store, split by what they are spent on
+struct StoreMemoryUsage
+{
+    size_t records = 0;      // hot record segments and the cold details table
+    size_t strings = 0;      // heap buffers of the string fields
+    size_t numeric = 0;      // numeric columns
+    size_t dictionaries = 0; // categorical dictionaries
+    size_t zoneMaps = 0;     // segment zone maps
+    size_t hashIndexes = 0;  // case-folded hash indexes on the categorical columns
+    size_t bitmaps = 0;      // per-value and is_fraud row bitmaps
+    size_t rangeIndexes = 0; // ordered indexes on amount, timestamp and time of day
+    size_t idIndex = 0;      // transaction_id hash table
+
+    size_t total() const
+    {
+        return records + strings + numeric + dictionaries + zoneMaps + hashIndexes + bitmaps + rangeIndexes + idIndex;
+    }
+};
+
+// How much of the store a segment-skipping scan actually touched
+struct ScanStats
+{
+    uint32_t segmentsVisited = 0;
+    uint32_t segmentsSkipped = 0;
+};
+
+// Owns every loaded transaction; the row id of a transaction is its load position.
+// Hot records are allocated a segment at a time so they stay contiguous and
+// keep their address while the store grows; the details are a cold side table.
+class TransactionStore
+{
+private:
+    std::vector<std::unique_ptr<Transaction[]>> hotSegments;
+    std::vector<TransactionDetails> details;
+    uint32_t rowCount = 0;
+    Dictionary dictionaries[CATEGORICAL_COLUMN_COUNT];
+    FoldedHashIndex hashIndexes[CATEGORICAL_COLUMN_COUNT];
+    std::vector<RowBitmap> valueBitmaps[CATEGORICAL_COLUMN_COUNT]; // indexed by dictionary code
+    RowBitmap fraudRows;
+    RangeIndex rangeIndexes[RANGE_COLUMN_COUNT];
+    TransactionIdIndex idIndex;
+    NumericColumns numeric;
+    std::vector<SegmentZoneMap> segments;
+
+    // Visits the rows of every segment whose zone map passes `segmentTest`,
+    // collecting the row ids that pass `rowTest`
+    template <typename SegmentTest, typename RowTest>
+    std::vector<uint32_t> scanSegments(SegmentTest segmentTest, RowTest rowTest, ScanStats &stats) const
+    {
+        std::vector<uint32_t> matches;
+        for (const SegmentZoneMap &zone : segments)
+        {
+            if (!segmentTest(zone))
+            {
+                ++stats.segmentsSkipped;
+                continue;
+            }
+            ++stats.segmentsVisited;
+            for (uint32_t row = zone.firstRow; row < zone.firstRow + zone.rowCount; ++row)
+            {
+                if (rowTest(row))
+                    matches.push_back(row);
+            }
+        }
+        return matches;
+    }
+
+public:
+    explicit TransactionStore(StorageMode mode = STORAGE_EXACT) : numeric(mode) {}
+    TransactionStore(const TransactionStore &) = delete;
+    TransactionStore &operator=(const TransactionStore &) = delete;
+
+    // Adds one parsed row; `values` holds the raw text of every categorical column
+    Transaction *add(TransactionDetails &&rowDetails, const std::string (&values)[CATEGORICAL_COLUMN_COUNT],
+                     const TransactionMetrics &metrics)
+    {
+        uint32_t rowId = rowCount++;
+        if (rowId % SEGMENT_ROWS == 0)
+        {
+            hotSegments.emplace_back(new Transaction[SEGMENT_ROWS]);
+            segments.emplace_back();
+            segments.back().firstRow = rowId;
+        }
+
+        Transaction *t = row(rowId);
+        t->row_id = rowId;
+        for (int c = 0; c < CATEGORICAL_COLUMN_COUNT; ++c)
+        {
+            t->codes[c] = dictionaries[c].encode(values[c]);
+            hashIndexes[c].add(rowId, t->codes[c], dictionaries[c].folded(t->codes[c]));
+            if (t->codes[c] == valueBitmaps[c].size())
+                valueBitmaps[c].emplace_back();
+            valueBitmaps[c][t->codes[c]].append(rowId);
+        }
+        if (metrics.is_fraud)
+            fraudRows.append(rowId);
+        details.push_back(std::move(rowDetails));
+        idIndex.add(rowId, details);
+        numeric.append(metrics);
+        rangeIndexes[RANGE_AMOUNT].append(numeric.amountMinorUnits(rowId), rowId);
+        rangeIndexes[RANGE_TIMESTAMP].append(metrics.timestamp, rowId);
+        rangeIndexes[RANGE_TIME_OF_DAY].append((metrics.timestamp % MICROS_PER_DAY + MICROS_PER_DAY) % MICROS_PER_DAY, rowId);
+
+        segments.back().include(t, numeric);
+        return t;
+    }
+
+    Transaction *row(uint32_t rowId) const { return &hotSegments[rowId / SEGMENT_ROWS][rowId % SEGMENT_ROWS]; }
+    const NumericColumns &numbers() const { return numeric; }
+    double amount(const Transaction *t) const { return numeric.amount(t->row_id); }
+    uint32_t size() const { return rowCount; }
+
+    // Cold fields of a row, materialized for print and export
+    const TransactionDetails &detailsOf(const Transaction *t) const { return details[t->row_id]; }
+    const std::string &value(const Transaction *t, CategoricalColumn column) const
+    {
+        return dictionaries[column].decode(t->codes[column]);
+    }
+    // Lower-cased value, folded once at ingest; compare it against a query
+    // folded once instead of calling toLower per row
+    const std::string &foldedValue(const Transaction *t, CategoricalColumn column) const
+    {
+        return dictionaries[column].folded(t->codes[column]);
+    }
+    const Dictionary &dictionary(CategoricalColumn column) const { return dictionaries[column]; }
+    const FoldedHashIndex &hashIndex(CategoricalColumn column) const { return hashIndexes[column]; }
+    const RowBitmap &codeBitmap(CategoricalColumn column, uint32_t code) const { return valueBitmaps[column][code]; }
+    const RowBitmap &fraudBitmap() const { return fraudRows; }
+    RowBitmap allRows() const { return RowBitmap::range(rowCount); }
+    const RangeIndex &rangeIndex(RangeColumn column) const { return rangeIndexes[column]; }
+    const TransactionIdIndex &transactionIds() const { return idIndex; }
+
+    // The row with this transaction_id, or nullptr
+    Transaction *findById(const std::string &id) const
+    {
+        uint32_t rowId = idIndex.find(id, details);
+        return rowId == UINT32_MAX ? nullptr : row(rowId);
+    }
+    uint32_t segmentCount() const { return static_cast<uint32_t>(segments.size()); }
+
+    StoreMemoryUsage memoryUsage() const
+    {
+        StoreMemoryUsage usage;
+        usage.records = vectorHeapBytes(hotSegments) + hotSegments.size() * heapBlockBytes(SEGMENT_ROWS * sizeof(Transaction)) +
+                        vectorHeapBytes(details);
+        for (const TransactionDetails &d : details)
+        {
+            usage.strings += stringHeapBytes(d.transaction_id) + stringHeapBytes(d.timestamp) +
+                             stringHeapBytes(d.sender_account) + stringHeapBytes(d.receiver_account) +
+                             stringHeapBytes(d.ip_address) + stringHeapBytes(d.device_hash);
+        }
+        usage.numeric = numeric.memoryUsage();
+        for (int c = 0; c < CATEGORICAL_COLUMN_COUNT; ++c)
+        {
+            usage.dictionaries += dictionaries[c].memoryUsage();
+            usage.hashIndexes += hashIndexes[c].memoryUsage();
+            usage.bitmaps += vectorHeapBytes(valueBitmaps[c]);
+            for (const RowBitmap &bitmap : valueBitmaps[c])
+                usage.bitmaps += bitmap.memoryUsage();
+        }
+        usage.bitmaps += fraudRows.memoryUsage();
+        for (int c = 0; c < RANGE_COLUMN_COUNT; ++c)
+            usage.rangeIndexes += rangeIndexes[c].memoryUsage();
+        usage.idIndex = idIndex.memoryUsage();
+        usage.zoneMaps = vectorHeapBytes(segments);
+        for (const SegmentZoneMap &zone : segments)
+            usage.zoneMaps += zone.memoryUsage();
+        return usage;
+    }
+
+    // Row ids with lo <= amount <= hi, in row id order
+    std::vector<uint32_t> scanAmountRange(double lo, double hi, ScanStats &stats) const
+    {
+        return scanSegments(
+            [lo, hi](const SegmentZoneMap &zone)
+            { return zone.maxAmount >= lo && zone.minAmount <= hi; },
+            [this, lo, hi](uint32_t row)
+            { double a = numeric.amount(row); return a >= lo && a <= hi; },
+            stats);
+    }
+
+    std::vector<uint32_t> scanTimestampRange(int64_t lo, int64_t hi, ScanStats &stats) const
+    {
+        return scanSegments(
+            [lo, hi](const SegmentZoneMap &zone)
+            { return zone.maxTimestamp >= lo && zone.minTimestamp <= hi; },
+            [this, lo, hi](uint32_t row)
+            { int64_t ts = numeric.timestamp(row); return ts >= lo && ts <= hi; },
+            stats);
+    }
+
+    std::vector<uint32_t> scanScoreRange(ScoreColumn column, double lo, double hi, ScanStats &stats) const
+    {
+        return scanSegments(
+            [column, lo, hi](const SegmentZoneMap &zone)
+            { return zone.maxScore[column] >= lo && zone.minScore[column] <= hi; },
+            [this, column, lo, hi](uint32_t row)
+            { double v = numeric.score(column, row); return v >= lo && v <= hi; },
+            stats);
+    }
+
+    // Row ids whose code in `column` is any of `codes`
+    std::vector<uint32_t> scanCodes(CategoricalColumn column, const std::vector<uint32_t> &codes, ScanStats &stats) const
+    {
+        return scanSegments(
+            [column, &codes](const SegmentZoneMap &zone)
+            {
+                for (uint32_t code : codes)
+                {
+                    if (zone.hasCode(column, code))
+                        return true;
+                }
+                return false;
+            },
+            [this, column, &codes](uint32_t row)
+            { return std::find(codes.begin(), codes.end(), this->row(row)->codes[column]) != codes.end(); },
+            stats);
+    }
+
+};
+
+// Row ids grouped by the dictionary code of one column: the rows of partition
+// `code` are rowIds[offsets[code]] .. rowIds[offsets[code + 1] - 1], in load order
+struct PartitionIndex
+{
+    CategoricalColumn column;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> rowIds;
+
+    uint32_t partitionCount() const { return offsets.empty() ? 0 : static_cast<uint32_t>(offsets.size() - 1); }
+    uint32_t partitionSize(uint32_t code) const { return offsets[code + 1] - offsets[code]; }
+    const uint32_t *begin(uint32_t code) const { return rowIds.data() + offsets[code]; }
+    const uint32_t *end(uint32_t code) const { return rowIds.data() + offsets[code + 1]; }
+
+    size_t memoryUsage() const { return vectorHeapBytes(offsets) + vectorHeapBytes(rowIds); }
+};
+
+// Counting sort on dictionary codes. The dictionary already holds the per-code
+// histogram, so this is a prefix sum plus a single scatter pass over the rows.
+PartitionIndex buildPartitionIndex(const TransactionStore &store, CategoricalColumn column)
+{
+    const Dictionary &dict = store.dictionary(column);
+    PartitionIndex index;
+    index.column = column;
+    index.offsets.assign(dict.size() + 1, 0);
+    for (uint32_t code = 0; code < dict.size(); ++code)
+        index.offsets[code + 1] = index.offsets[code] + dict.count(code);
+
+    std::vector<uint32_t> cursor(index.offsets.begin(), index.offsets.end() - 1);
+    index.rowIds.resize(store.size());
+    for (uint32_t rowId = 0; rowId < store.size(); ++rowId)
+        index.rowIds[cursor[store.row(rowId)->codes[column]]++] = rowId;
+
+    return index;
+}
+
+// Per-account history: the rows each account sent and received, each list in
+// timestamp order (row id on ties). Accounts are split into one hash shard per
+// build thread. The threads first hash both account columns of a slice of the
+// rows, then each fills its own shard, so no map is shared between threads.
+class AccountIndex
+{
+private:
+    struct Postings
+    {
+        std::vector<uint32_t> sent;
+        std::vector<uint32_t> received;
+    };
+    std::vector<std::unordered_map<std::string, Postings>> shards;
+
+    const Postings *find(const std::string &account) const
+    {
+        if (shards.empty())
+            return nullptr;
+        const auto &shard = shards[std::hash<std::string>()(account) % shards.size()];
+        auto it = shard.find(account);
+        return it == shard.end() ? nullptr : &it->second;
+    }
+
+public:
+    void build(const TransactionStore &store, unsigned threadCount)
+    {
+        uint32_t rows = store.size();
+        unsigned threads = std::max(1u, std::min<unsigned>(threadCount, rows / PARALLEL_SORT_MIN_CHUNK));
+        shards.assign(threads, {});
+        std::vector<uint32_t> senderShard(rows), receiverShard(rows);
+        auto run = [threads](auto work)
+        {
+            std::vector<std::thread> workers;
+            for (unsigned t = 1; t < threads; ++t)
+                workers.emplace_back(work, t);
+            work(0);
+            for (std::thread &worker : workers)
+                worker.join();
+        };
+
+        run([&](unsigned t)
+            {
+                std::hash<std::string> hash;
+                uint32_t first = static_cast<uint32_t>(static_cast<uint64_t>(rows) * t / threads);
+                uint32_t last = static_cast<uint32_t>(static_cast<uint64_t>(rows) * (t + 1) / threads);
+                for (uint32_t rowId = first; rowId < last; ++rowId)
+                {
+                    const TransactionDetails &d = store.detailsOf(store.row(rowId));
+                    senderShard[rowId] = static_cast<uint32_t>(hash(d.sender_account) % threads);
+                    receiverShard[rowId] = static_cast<uint32_t>(hash(d.receiver_account) % threads);
+                } });
+
+        const NumericColumns &numbers = store.numbers();
+        run([&](unsigned t)
+            {
+                auto &shard = shards[t];
+                for (uint32_t rowId = 0; rowId < rows; ++rowId)
+                {
+                    if (senderShard[rowId] == t)
+                        shard[store.detailsOf(store.row(rowId)).sender_account].sent.push_back(rowId);
+                    if (receiverShard[rowId] == t)
+                        shard[store.detailsOf(store.row(rowId)).receiver_account].received.push_back(rowId);
+                }
+                // Rows usually load in time order already; sort only the lists that did not
+                auto byTime = [&numbers](uint32_t a, uint32_t b)
+                { return numbers.timestamp(a) < numbers.timestamp(b); };
+                for (auto &entry : shard)
+                {
+                    for (std::vector<uint32_t> *list : {&entry.second.sent, &entry.second.received})
+                    {
+                        list->shrink_to_fit();
+                        if (!std::is_sorted(list->begin(), list->end(), byTime))
+                            std::stable_sort(list->begin(), list->end(), byTime);
+                    }
+                } });
+    }
+
+    const std::vector<uint32_t> &sent(const std::string &account) const
+    {
+        static const std::vector<uint32_t> none;
+        const Postings *postings = find(account);
+        return postings ? postings->sent : none;
+    }
+
+    const std::vector<uint32_t> &received(const std::string &account) const
+    {
+        static const std::vector<uint32_t> none;
+        const Postings *postings = find(account);
+        return postings ? postings->received : none;
+    }
+
+    // Everything the account sent or received, merged in timestamp order; a
+    // transfer to itself is listed once
+    std::vector<uint32_t> history(const TransactionStore &store, const std::string &account) const
+    {
+        const std::vector<uint32_t> &out = sent(account), &in = received(account);
+        const NumericColumns &numbers = store.numbers();
+        std::vector<uint32_t> rows;
+        rows.reserve(out.size() + in.size());
+        std::merge(out.begin(), out.end(), in.begin(), in.end(), std::back_inserter(rows),
+                   [&numbers](uint32_t a, uint32_t b)
+                   { return numbers.timestamp(a) < numbers.timestamp(b) ||
+                            (numbers.timestamp(a) == numbers.timestamp(b) && a < b); });
+        rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+        return rows;
+    }
+
+    size_t accountCount() const
+    {
+        size_t total = 0;
+        for (const auto &shard : shards)
+            total += shard.size();
+        return total;
+    }
+
+    size_t memoryUsage() const
+    {
+        size_t mapNode = sizeof(void *) + sizeof(std::pair<const std::string, Postings>) + sizeof(size_t);
+        size_t total = vectorHeapBytes(shards);
+        for (const auto &shard : shards)
+        {
+            total += heapBlockBytes(shard.bucket_count() * sizeof(void *)) + shard.size() * heapBlockBytes(mapNode);
+            for (const auto &entry : shard)
+                total += stringHeapBytes(entry.first) + vectorHeapBytes(entry.second.sent) +
+                         vectorHeapBytes(entry.second.received);
+        }
+        return total;
+    }
+};
+
+// ---- Predicate query engine ----
+// A query is a tree of predicates over any transaction column: =, !=, IN, <,
+// <=, >, >=, BETWEEN and PREFIX leaves under AND / OR / NOT. Each leaf is
+// answered from an index (value bitmaps, fraud bitmap, range index, id or
+// account index) or by a scan, chosen from a cardinality estimate. AND runs
+// its most selective child first and, once the survivors are fewer than the
+// next child's estimate, tests them row by row instead of evaluating that
+// child in full. The result is a RowBitmap selection.
+enum QueryField
+{
+    FIELD_CATEGORICAL,
+    FIELD_FRAUD,
+    FIELD_AMOUNT,
+    FIELD_TIMESTAMP,
+    FIELD_SCORE,
+    FIELD_TRANSACTION_ID,
+    FIELD_SENDER,
+    FIELD_RECEIVER,
+    FIELD_IP_ADDRESS,
+    FIELD_DEVICE_HASH
+};
+
+enum PredicateOp
+{
+    PRED_EQ,
+    PRED_IN,
+    PRED_LT,
+    PRED_LE,
+    PRED_GT,
+    PRED_GE,
+    PRED_BETWEEN,
+    PRED_PREFIX,
+    PRED_AND,
+    PRED_OR,
+    PRED_NOT
+};
+
+struct Predicate
+{
+    PredicateOp op = PRED_EQ;
+    std::string text; // as shown by explain
+    std::vector<std::unique_ptr<Predicate>> children;
+
+    // Leaf operands. Text fields keep `values` (folded for categorical
+    // columns); numeric fields are reduced to an inclusive range.
+    QueryField field = FIELD_CATEGORICAL;
+    CategoricalColumn categorical = COL_TRANSACTION_TYPE;
+    ScoreColumn score = SCORE_TIME_SINCE_LAST;
+    std::vector<std::string> values;
+    int64_t keyLo = INT64_MIN, keyHi = INT64_MAX; // amount in cents, timestamp in microseconds
+    double lo = -HUGE_VAL, hi = HUGE_VAL;         // scores
+    bool fraud = true;
+
+    // Filled in by the planner and the evaluation
+    std::vector<uint8_t> codeMatches; // categorical: does each dictionary code match
+    double estimate = 0;
+    const char *access = "";
+    bool useIndex = false; // amount / timestamp: range index rather than a scan
+    uint32_t actual = 0;
+    bool filtered = false; // tested row by row against AND survivors
+};
+
+// Recursive-descent parser for the query text. OR binds loosest, then AND,
+// then NOT; parentheses group. Values are bare words or quoted strings.
+class PredicateParser
+{
+private:
+    struct Token
+    {
+        std::string text;
+        bool quoted;
+    };
+    std::vector<Token> tokens;
+    size_t pos = 0;
+    std::string error;
+
+    bool tokenize(const std::string &query)
+    {
+        const std::string symbols = "(),=!<>";
+        for (size_t i = 0; i < query.size();)
+        {
+            char ch = query[i];
+            if (std::isspace(static_cast<unsigned char>(ch)))
+                ++i;
+            else if (ch == '\'' || ch == '"')
+            {
+                size_t close = query.find(ch, i + 1);
+                if (close == std::string::npos)
+                {
+                    error = "unterminated quote";
+                    return false;
+                }
+                tokens.push_back({query.substr(i + 1, close - i - 1), true});
+                i = close + 1;
+            }
+            else if (symbols.find(ch) != std::string::npos)
+            {
+                size_t length = (ch == '!' || ch == '<' || ch == '>') && i + 1 < query.size() && query[i + 1] == '=' ? 2 : 1;
+                tokens.push_back({query.substr(i, length), false});
+                i += length;
+            }
+            else
+            {
+                size_t end = i;
+                while (end < query.size() && !std::isspace(static_cast<unsigned char>(query[end])) &&
+                       symbols.find(query[end]) == std::string::npos && query[end] != '\'' && query[end] != '"')
+                    ++end;
+                tokens.push_back({query.substr(i, end - i), false});
+                i = end;
+            }
+        }
+        return true;
+    }
+
+    bool at(const char *word) const
+    {
+        return pos < tokens.size() && !tokens[pos].quoted && equalsIgnoreCase(tokens[pos].text, word);
+    }
+
+    bool accept(const char *word)
+    {
+        if (!at(word))
+            return false;
+        ++pos;
+        return true;
+    }
+
+    bool readValue(std::string &value)
+    {
+        if (pos == tokens.size() || (!tokens[pos].quoted && std::string("(),=!<>").find(tokens[pos].text[0]) != std::string::npos))
+        {
+            error = "expected a value";
+            return false;
+        }
+        value = tokens[pos++].text;
+        return true;
+    }
+
+    static std::unique_ptr<Predicate> node(PredicateOp op, const char *text)
+    {
+        std::unique_ptr<Predicate> p(new Predicate);
+        p->op = op;
+        p->text = text;
+        return p;
+    }
+
+    bool resolveField(const std::string &name, Predicate &leaf)
+    {
+        std::string lowerName = toLower(name);
+        if (parseCategoricalColumn(lowerName, leaf.categorical))
+            leaf.field = FIELD_CATEGORICAL;
+        else if (parseScoreColumn(lowerName, leaf.score))
+            leaf.field = FIELD_SCORE;
+        else if (lowerName == "is_fraud")
+            leaf.field = FIELD_FRAUD;
+        else if (lowerName == "amount")
+            leaf.field = FIELD_AMOUNT;
+        else if (lowerName == "timestamp")
+            leaf.field = FIELD_TIMESTAMP;
+        else if (lowerName == "transaction_id")
+            leaf.field = FIELD_TRANSACTION_ID;
+        else if (lowerName == "sender_account")
+            leaf.field = FIELD_SENDER;
+        else if (lowerName == "receiver_account")
+            leaf.field = FIELD_RECEIVER;
+        else if (lowerName == "ip_address")
+            leaf.field = FIELD_IP_ADDRESS;
+        else if (lowerName == "device_hash")
+            leaf.field = FIELD_DEVICE_HASH;
+        else
+        {
+            error = "unknown column " + name;
+            return false;
+        }
+        return true;
+    }
+
+    // Narrows a numeric leaf's inclusive range by one bound; op is one of
+    // EQ, LT, LE, GT, GE
+    bool bindBound(Predicate &leaf, PredicateOp op, const std::string &value)
+    {
+        bool lower = op == PRED_EQ || op == PRED_GT || op == PRED_GE;
+        bool upper = op == PRED_EQ || op == PRED_LT || op == PRED_LE;
+        if (leaf.field == FIELD_TIMESTAMP)
+        {
+            int64_t micros;
+            if (!parseTimestamp(value, micros))
+            {
+                error = "invalid timestamp " + value;
+                return false;
+            }
+            if (lower)
+                leaf.keyLo = std::max(leaf.keyLo, op == PRED_GT ? micros + 1 : micros);
+            if (upper)
+                leaf.keyHi = std::min(leaf.keyHi, op == PRED_LT ? micros - 1 : micros);
+            return true;
+        }
+
+        char *end;
+        double number = std::strtod(value.c_str(), &end);
+        if (end == value.c_str() || *end)
+        {
+            error = "invalid number " + value;
+            return false;
+        }
+        if (leaf.field == FIELD_AMOUNT)
+        {
+            // whole cents only: 10.005 matches nothing with =, and < 10.005 includes 10.00
+            double cents = number * 100.0;
+            int64_t floorCents = static_cast<int64_t>(std::floor(cents + 1e-6));
+            int64_t ceilCents = static_cast<int64_t>(std::ceil(cents - 1e-6));
+            if (lower)
+                leaf.keyLo = std::max(leaf.keyLo, op == PRED_GT ? floorCents + 1 : ceilCents);
+            if (upper)
+                leaf.keyHi = std::min(leaf.keyHi, op == PRED_LT ? ceilCents - 1 : floorCents);
+        }
+        else
+        {
+            if (lower)
+                leaf.lo = std::max(leaf.lo, op == PRED_GT ? std::nextafter(number, HUGE_VAL) : number);
+            if (upper)
+                leaf.hi = std::min(leaf.hi, op == PRED_LT ? std::nextafter(number, -HUGE_VAL) : number);
+        }
+        return true;
+    }
+
+    std::unique_ptr<Predicate> parseOr()
+    {
+        std::unique_ptr<Predicate> left = parseAnd();
+        if (!left || !at("or"))
+            return left;
+        std::unique_ptr<Predicate> any = node(PRED_OR, "OR");
+        any->children.push_back(std::move(left));
+        while (accept("or"))
+        {
+            std::unique_ptr<Predicate> next = parseAnd();
+            if (!next)
+                return nullptr;
+            any->children.push_back(std::move(next));
+        }
+        return any;
+    }
+
+    std::unique_ptr<Predicate> parseAnd()
+    {
+        std::unique_ptr<Predicate> left = parseUnary();
+        if (!left || !at("and"))
+            return left;
+        std::unique_ptr<Predicate> all = node(PRED_AND, "AND");
+        all->children.push_back(std::move(left));
+        while (accept("and"))
+        {
+            std::unique_ptr<Predicate> next = parseUnary();
+            if (!next)
+                return nullptr;
+            all->children.push_back(std::move(next));
+        }
+        return all;
+    }
+
+    std::unique_ptr<Predicate> parseUnary()
+    {
+        if (accept("not"))
+        {
+            std::unique_ptr<Predicate> inner = parseUnary();
+            if (!inner)
+                return nullptr;
+            std::unique_ptr<Predicate> negated = node(PRED_NOT, "NOT");
+            negated->children.push_back(std::move(inner));
+            return negated;
+        }
+        if (accept("("))
+        {
+            std::unique_ptr<Predicate> inner = parseOr();
+            if (inner && !accept(")"))
+            {
+                error = "expected )";
+                return nullptr;
+            }
+            return inner;
+        }
+        return parseComparison();
+    }
+
+    std::unique_ptr<Predicate> parseComparison()
+    {
+        std::string name;
+        if (!readValue(name))
+            return nullptr;
+        std::unique_ptr<Predicate> leaf = node(PRED_EQ, "");
+        if (!resolveField(name, *leaf))
+            return nullptr;
+
+        // a bare is_fraud means is_fraud = true
+        if (leaf->field == FIELD_FRAUD && !(at("=") || at("!=")))
+        {
+            leaf->text = "is_fraud";
+            return leaf;
+        }
+
+        std::string opText = pos < tokens.size() ? tokens[pos].text : "";
+        PredicateOp op;
+        if (accept("="))
+            op = PRED_EQ;
+        else if (accept("!="))
+            op = PRED_EQ;
+        else if (accept("<"))
+            op = PRED_LT;
+        else if (accept("<="))
+            op = PRED_LE;
+        else if (accept(">"))
+            op = PRED_GT;
+        else if (accept(">="))
+            op = PRED_GE;
+        else if (accept("in"))
+            op = PRED_IN;
+        else if (accept("between"))
+            op = PRED_BETWEEN;
+        else if (accept("prefix"))
+            op = PRED_PREFIX;
+        else
+        {
+            error = "expected an operator after " + name;
+            return nullptr;
+        }
+
+        std::vector<std::string> operands(1);
+        if (op == PRED_IN)
+        {
+            operands.clear();
+            if (!accept("("))
+            {
+                error = "expected ( after IN";
+                return nullptr;
+            }
+            do
+            {
+                operands.emplace_back();
+                if (!readValue(operands.back()))
+                    return nullptr;
+            } while (accept(","));
+            if (!accept(")"))
+            {
+                error = "expected ) after the IN list";
+                return nullptr;
+            }
+        }
+        else if (!readValue(operands[0]))
+            return nullptr;
+        if (op == PRED_BETWEEN)
+        {
+            operands.emplace_back();
+            if (!accept("and") || !readValue(operands.back()))
+            {
+                error = "expected BETWEEN low AND high";
+                return nullptr;
+            }
+        }
+
+        // a != leaf is shown as the = leaf under its NOT
+        leaf->op = op;
+        leaf->text = name + " " + (opText == "!=" ? "=" : toUpperKeyword(opText)) + (op == PRED_IN ? " (" : " ");
+        for (size_t i = 0; i < operands.size(); ++i)
+            leaf->text += (i == 0 ? "" : (op == PRED_BETWEEN ? " AND " : ", ")) + operands[i];
+        if (op == PRED_IN)
+            leaf->text += ")";
+
+        bool numeric = leaf->field == FIELD_AMOUNT || leaf->field == FIELD_TIMESTAMP || leaf->field == FIELD_SCORE;
+        if (leaf->field == FIELD_FRAUD)
+        {
+            std::string value = toLower(operands[0]);
+            if (op != PRED_EQ || (value != "true" && value != "false" && value != "1" && value != "0"))
+            {
+                error = "is_fraud takes = true or = false";
+                return nullptr;
+            }
+            leaf->fraud = value == "true" || value == "1";
+        }
+        else if (numeric && op == PRED_PREFIX)
+        {
+            error = "PREFIX needs a text column";
+            return nullptr;
+        }
+        else if (numeric && op == PRED_IN)
+        {
+            // a numeric IN is an OR of equalities
+            std::unique_ptr<Predicate> any = node(PRED_OR, "OR");
+            any->text = leaf->text;
+            for (const std::string &operand : operands)
+            {
+                std::unique_ptr<Predicate> equal = node(PRED_EQ, "");
+                equal->field = leaf->field;
+                equal->score = leaf->score;
+                equal->text = name + " = " + operand;
+                if (!bindBound(*equal, PRED_EQ, operand))
+                    return nullptr;
+                any->children.push_back(std::move(equal));
+            }
+            leaf = std::move(any);
+        }
+        else if (numeric)
+        {
+            if (op == PRED_BETWEEN)
+            {
+                if (!bindBound(*leaf, PRED_GE, operands[0]) || !bindBound(*leaf, PRED_LE, operands[1]))
+                    return nullptr;
+            }
+            else if (!bindBound(*leaf, op, operands[0]))
+                return nullptr;
+        }
+        else
+        {
+            // categorical values match ignoring case, so their operands are folded here once
+            for (std::string &operand : operands)
+                leaf->values.push_back(leaf->field == FIELD_CATEGORICAL ? toLower(operand) : operand);
+        }
+
+        if (opText == "!=")
+        {
+            std::unique_ptr<Predicate> negated = node(PRED_NOT, "NOT");
+            negated->children.push_back(std::move(leaf));
+            return negated;
+        }
+        return leaf;
+    }
+
+    static std::string toUpperKeyword(const std::string &word)
+    {
+        std::string upper = word;
+        for (char &ch : upper)
+            ch = std::toupper(static_cast<unsigned char>(ch));
+        return upper;
+    }
+
+public:
+    // Parses `query`; on failure returns nullptr and describes why in `message`
+    std::unique_ptr<Predicate> parse(const std::string &query, std::string &message)
+    {
+        tokens.clear();
+        pos = 0;
+        error.clear();
+        std::unique_ptr<Predicate> root;
+        if (tokenize(query))
+            root = parseOr();
+        if (root && pos != tokens.size())
+        {
+            error = "unexpected " + tokens[pos].text;
+            root.reset();
+        }
+        if (!root && error.empty())
+            error = "empty query";
+        message = error;
+        return root;
+    }
+};
+
+// Plans and evaluates a parsed predicate tree against the store. The account
+// index is optional; without it sender/receiver equality falls back to a scan.
+class QueryEngine
+{
+private:
+    const TransactionStore &store;
+    const AccountIndex *accounts;
+
+    const std::string &textOf(QueryField field, uint32_t rowId) const
+    {
+        const TransactionDetails &d = store.detailsOf(store.row(rowId));
+        switch (field)
+        {
+        case FIELD_TRANSACTION_ID:
+            return d.transaction_id;
+        case FIELD_SENDER:
+            return d.sender_account;
+        case FIELD_RECEIVER:
+            return d.receiver_account;
+        case FIELD_IP_ADDRESS:
+            return d.ip_address;
+        default:
+            return d.device_hash;
+        }
+    }
+
+    static bool matchesText(const Predicate &p, const std::string &value)
+    {
+        const std::vector<std::string> &v = p.values;
+        switch (p.op)
+        {
+        case PRED_EQ:
+        case PRED_IN:
+            return std::find(v.begin(), v.end(), value) != v.end();
+        case PRED_PREFIX:
+            return value.compare(0, v[0].size(), v[0]) == 0;
+        case PRED_LT:
+            return value < v[0];
+        case PRED_LE:
+            return value <= v[0];
+        case PRED_GT:
+            return value > v[0];
+        case PRED_GE:
+            return value >= v[0];
+        case PRED_BETWEEN:
+            return value >= v[0] && value <= v[1];
+        default:
+            return false;
+        }
+    }
+
+    bool keyedLookup(const Predicate &p) const
+    {
+        return p.op == PRED_EQ || p.op == PRED_IN;
+    }
+
+    // Row ids from an index, which may come in any order, as a selection
+    static RowBitmap selectionOf(std::vector<uint32_t> rowIds)
+    {
+        std::sort(rowIds.begin(), rowIds.end());
+        rowIds.erase(std::unique(rowIds.begin(), rowIds.end()), rowIds.end());
+        return RowBitmap::fromSorted(rowIds);
+    }
+
+    RowBitmap scan(const Predicate &p) const
+    {
+        RowBitmap rows;
+        for (uint32_t rowId = 0; rowId < store.size(); ++rowId)
+        {
+            if (matches(p, rowId))
+                rows.append(rowId);
+        }
+        return rows;
+    }
+
+    RowBitmap evaluateLeaf(Predicate &p) const
+    {
+        ScanStats stats;
+        switch (p.field)
+        {
+        case FIELD_CATEGORICAL:
+        {
+            RowBitmap rows;
+            for (uint32_t code = 0; code < p.codeMatches.size(); ++code)
+            {
+                if (p.codeMatches[code])
+                    rows = rows.unite(store.codeBitmap(p.categorical, code));
+            }
+            return rows;
+        }
+        case FIELD_FRAUD:
+            return p.fraud ? store.fraudBitmap() : store.allRows().subtract(store.fraudBitmap());
+        case FIELD_AMOUNT:
+            if (p.useIndex)
+                return selectionOf(store.rangeIndex(RANGE_AMOUNT).rangeRowIds(p.keyLo, p.keyHi));
+            else
+            {
+                // widened by half a cent, then checked in whole cents
+                std::vector<uint32_t> rowIds = store.scanAmountRange((p.keyLo - 0.5) / 100.0, (p.keyHi + 0.5) / 100.0, stats);
+                rowIds.erase(std::remove_if(rowIds.begin(), rowIds.end(), [&](uint32_t rowId)
+                                            { return !matches(p, rowId); }),
+                             rowIds.end());
+                return RowBitmap::fromSorted(rowIds);
+            }
+        case FIELD_TIMESTAMP:
+            if (p.useIndex)
+                return selectionOf(store.rangeIndex(RANGE_TIMESTAMP).rangeRowIds(p.keyLo, p.keyHi));
+            return RowBitmap::fromSorted(store.scanTimestampRange(p.keyLo, p.keyHi, stats));
+        case FIELD_SCORE:
+            return RowBitmap::fromSorted(store.scanScoreRange(p.score, p.lo, p.hi, stats));
+        case FIELD_TRANSACTION_ID:
+            if (keyedLookup(p))
+            {
+                std::vector<uint32_t> rowIds;
+                for (const std::string &id : p.values)
+                {
+                    if (const Transaction *t = store.findById(id))
+                        rowIds.push_back(t->row_id);
+                }
+                return selectionOf(rowIds);
+            }
+            return scan(p);
+        case FIELD_SENDER:
+        case FIELD_RECEIVER:
+            if (keyedLookup(p) && accounts)
+            {
+                std::vector<uint32_t> rowIds;
+                for (const std::string &account : p.values)
+                {
+                    const std::vector<uint32_t> &list = p.field == FIELD_SENDER ? accounts->sent(account) : accounts->received(account);
+                    rowIds.insert(rowIds.end(), list.begin(), list.end());
+                }
+                return selectionOf(rowIds);
+            }
+            return scan(p);
+        default:
+            return scan(p);
+        }
+    }
+
+public:
+    QueryEngine(const TransactionStore &store, const AccountIndex *accounts = nullptr) : store(store), accounts(accounts) {}
+
+    // Row-at-a-time test, used by scans and to filter AND survivors
+    bool matches(const Predicate &p, uint32_t rowId) const
+    {
+        switch (p.op)
+        {
+        case PRED_AND:
+            for (const auto &child : p.children)
+            {
+                if (!matches(*child, rowId))
+                    return false;
+            }
+            return true;
+        case PRED_OR:
+            for (const auto &child : p.children)
+            {
+                if (matches(*child, rowId))
+                    return true;
+            }
+            return false;
+        case PRED_NOT:
+            return !matches(*p.children[0], rowId);
+        default:
+            break;
+        }
+
+        const NumericColumns &numbers = store.numbers();
+        const Transaction *t = store.row(rowId);
+        switch (p.field)
+        {
+        case FIELD_CATEGORICAL:
+            return p.codeMatches[t->codes[p.categorical]] != 0;
+        case FIELD_FRAUD:
+            return numbers.isFraud(rowId) == p.fraud;
+        case FIELD_AMOUNT:
+        {
+            int64_t cents = numbers.amountMinorUnits(rowId);
+            return cents >= p.keyLo && cents <= p.keyHi;
+        }
+        case FIELD_TIMESTAMP:
+        {
+            int64_t micros = numbers.timestamp(rowId);
+            return micros >= p.keyLo && micros <= p.keyHi;
+        }
+        case FIELD_SCORE:
+        {
+            double value = numbers.score(p.score, rowId);
+            return value >= p.lo && value <= p.hi;
+        }
+        default:
+            return matchesText(p, textOf(p.field, rowId));
+        }
+    }
+
+    // Estimates every node's cardinality and picks each leaf's access path.
+    // Categorical, fraud and range estimates are exact (dictionary counts,
+    // bitmap and index counts); the rest use fixed selectivities.
+    void plan(Predicate &p) const
+    {
+        double rows = store.size();
+        switch (p.op)
+        {
+        case PRED_AND:
+            p.estimate = rows;
+            for (auto &child : p.children)
+            {
+                plan(*child);
+                p.estimate = std::min(p.estimate, child->estimate);
+            }
+            std::stable_sort(p.children.begin(), p.children.end(), [](const auto &a, const auto &b)
+                             { return a->estimate < b->estimate; });
+            return;
+        case PRED_OR:
+            p.estimate = 0;
+            for (auto &child : p.children)
+            {
+                plan(*child);
+                p.estimate = std::min(rows, p.estimate + child->estimate);
+            }
+            return;
+        case PRED_NOT:
+            plan(*p.children[0]);
+            p.estimate = rows - p.children[0]->estimate;
+            return;
+        default:
+            break;
+        }
+
+        switch (p.field)
+        {
+        case FIELD_CATEGORICAL:
+        {
+            const Dictionary &dict = store.dictionary(p.categorical);
+            p.codeMatches.assign(dict.size(), 0);
+            p.estimate = 0;
+            for (uint32_t code = 0; code < dict.size(); ++code)
+            {
+                p.codeMatches[code] = matchesText(p, dict.folded(code));
+                if (p.codeMatches[code])
+                    p.estimate += dict.count(code);
+            }
+            p.access = "value bitmaps";
+            return;
+        }
+        case FIELD_FRAUD:
+            p.estimate = p.fraud ? store.fraudBitmap().cardinality() : rows - store.fraudBitmap().cardinality();
+            p.access = "fraud bitmap";
+            return;
+        case FIELD_AMOUNT:
+        case FIELD_TIMESTAMP:
+            p.estimate = store.rangeIndex(p.field == FIELD_AMOUNT ? RANGE_AMOUNT : RANGE_TIMESTAMP).count(p.keyLo, p.keyHi);
+            p.useIndex = p.estimate * QUERY_INDEX_FRACTION <= rows;
+            p.access = p.useIndex ? "range index" : "zone-map scan";
+            return;
+        case FIELD_SCORE:
+            p.estimate = rows / 3;
+            p.access = "zone-map scan";
+            return;
+        case FIELD_TRANSACTION_ID:
+            p.estimate = keyedLookup(p) ? p.values.size() : rows / 3;
+            p.access = keyedLookup(p) ? "id index" : "scan";
+            return;
+        case FIELD_SENDER:
+        case FIELD_RECEIVER:
+            if (keyedLookup(p) && accounts)
+            {
+                p.estimate = 0;
+                for (const std::string &account : p.values)
+                    p.estimate += (p.field == FIELD_SENDER ? accounts->sent(account) : accounts->received(account)).size();
+                p.access = "account index";
+                return;
+            }
+            break;
+        default:
+            break;
+        }
+        p.estimate = keyedLookup(p) ? std::min(rows, rows / 100 * p.values.size()) : rows / 3;
+        p.access = "scan";
+    }
+
+    RowBitmap evaluate(Predicate &p) const
+    {
+        RowBitmap rows;
+        if (p.op == PRED_AND)
+        {
+            rows = evaluate(*p.children[0]);
+            for (size_t i = 1; i < p.children.size(); ++i)
+            {
+                Predicate &child = *p.children[i];
+                if (rows.cardinality() < child.estimate)
+                {
+                    rows = rows.filter([&](uint32_t rowId) { return matches(child, rowId); });
+                    child.filtered = true;
+                    child.actual = rows.cardinality();
+                }
+                else if (child.op == PRED_NOT)
+                {
+                    rows = rows.subtract(evaluate(*child.children[0]));
+                    child.actual = store.size() - child.children[0]->actual;
+                }
+                else
+                    rows = rows.intersect(evaluate(child));
+            }
+        }
+        else if (p.op == PRED_OR)
+        {
+            for (auto &child : p.children)
+                rows = rows.unite(evaluate(*child));
+        }
+        else if (p.op == PRED_NOT)
+            rows = store.allRows().subtract(evaluate(*p.children[0]));
+        else
+            rows = evaluateLeaf(p);
+        p.actual = rows.cardinality();
+        return rows;
+    }
+
+    RowBitmap run(Predicate &query) const
+    {
+        plan(query);
+        return evaluate(query);
+    }
+
+    // Prints the plan tree with each node's access path, estimate and result
+    // size; below a filtered node nothing was evaluated on its own
+    void explain(const Predicate &p, int depth = 0, bool evaluated = true) const
+    {
+        std::cout << std::string(2 * depth + 2, ' ') << p.text;
+        if (p.filtered)
+            std::cout << "  [filter survivors]";
+        else if (*p.access && evaluated)
+            std::cout << "  [" << p.access << "]";
+        std::cout << "  est " << static_cast<uint64_t>(p.estimate);
+        if (evaluated)
+            std::cout << ", actual " << p.actual;
+        std::cout << "\n";
+        for (const auto &child : p.children)
+            explain(*child, depth + 1, evaluated && !p.filtered);
+    }
+};
+
+// Count, amount statistics and fraud count of a selection
+struct SelectionSummary
+{
+    uint32_t rows = 0;
+    int64_t totalCents = 0;
+    double minAmount = 0.0, maxAmount = 0.0;
+    uint32_t fraudRows = 0;
+};
+
+SelectionSummary summarizeSelection(const TransactionStore &store, const RowBitmap &selection)
+{
+    const NumericColumns &numbers = store.numbers();
+    SelectionSummary summary;
+    selection.forEach([&](uint32_t rowId)
+                      {
+                          double amount = numbers.amount(rowId);
+                          summary.minAmount = summary.rows == 0 ? amount : std::min(summary.minAmount, amount);
+                          summary.maxAmount = summary.rows == 0 ? amount : std::max(summary.maxAmount, amount);
+                          summary.totalCents += numbers.amountMinorUnits(rowId);
+                          summary.fraudRows += numbers.isFraud(rowId);
+                          ++summary.rows; });
+    return summary;
+}
+
+// Top-K selection. Rows are streamed through a bounded heap of K entries whose
+// root is the worst entry kept so far, so a row either loses to the root in
+// one comparison or replaces it in O(log K): O(n log K) instead of sorting
+// all n rows. Equal values are ranked by row id, making the result unique.
+struct TopKEntry
+{
+    double value;
+    uint32_t rowId;
+};
+
+// True if a ranks ahead of b in a top-K over the largest (or smallest) values
+inline bool topKAhead(const TopKEntry &a, const TopKEntry &b, bool largest)
+{
+    if (a.value != b.value)
+        return largest ? a.value > b.value : a.value < b.value;
+    return a.rowId < b.rowId;
+}
+
+inline void topKOffer(std::vector<TopKEntry> &heap, size_t k, const TopKEntry &entry, bool largest)
+{
+    auto ahead = [largest](const TopKEntry &a, const TopKEntry &b)
+    { return topKAhead(a, b, largest); };
+    if (heap.size() < k)
+    {
+        heap.push_back(entry);
+        std::push_heap(heap.begin(), heap.end(), ahead);
+    }
+    else if (ahead(entry, heap.front()))
+    {
+        std::pop_heap(heap.begin(), heap.end(), ahead);
+        heap.back() = entry;
+        std::push_heap(heap.begin(), heap.end(), ahead);
+    }
+}
+
+// The k rows with the largest (or smallest) key(rowId) among those passing
+// filter(rowId), best first. With threadCount > 1 every thread keeps its own
+// heap over a slice of the rows and the heaps are merged at the end; the
+// tie-break on row id makes the answer identical for any thread count.
+template <typename Key, typename Filter>
+std::vector<TopKEntry> topK(const TransactionStore &store, size_t k, bool largest, Key key, Filter filter,
+                            unsigned threadCount = 1)
+{
+    std::vector<TopKEntry> result;
+    if (k == 0)
+        return result;
+
+    uint32_t rows = store.size();
+    unsigned slices = std::max(1u, std::min<unsigned>(threadCount, rows / PARALLEL_SORT_MIN_CHUNK));
+    std::vector<std::vector<TopKEntry>> heaps(slices);
+    auto scan = [&, k, largest](unsigned slice)
+    {
+        std::vector<TopKEntry> &heap = heaps[slice];
+        heap.reserve(k);
+        uint32_t first = static_cast<uint32_t>(static_cast<uint64_t>(rows) * slice / slices);
+        uint32_t last = static_cast<uint32_t>(static_cast<uint64_t>(rows) * (slice + 1) / slices);
+        for (uint32_t rowId = first; rowId < last; ++rowId)
+        {
+            if (filter(rowId))
+                topKOffer(heap, k, TopKEntry{static_cast<double>(key(rowId)), rowId}, largest);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned slice = 1; slice < slices; ++slice)
+        workers.emplace_back(scan, slice);
+    scan(0);
+    for (std::thread &worker : workers)
+        worker.join();
+
+    result = std::move(heaps[0]);
+    for (unsigned slice = 1; slice < slices; ++slice)
+    {
+        for (const TopKEntry &entry : heaps[slice])
+            topKOffer(result, k, entry, largest);
+    }
+    std::sort_heap(result.begin(), result.end(), [largest](const TopKEntry &a, const TopKEntry &b)
+                   { return topKAhead(a, b, largest); });
+    return result;
+}
+
+// Row ids of the whole store sorted by one categorical column, cached per
+// (column, ignoreCase) key so any number of orders coexist and asking for one
+// again costs nothing. A permutation is built on first use by counting sort on
+// the order-preserving ranks, ties in row id order. Rows ingested after that
+// are sorted on their own and merged in on the next request; ranks only ever
+// gain new values, so the already-sorted prefix keeps its relative order.
+class SortedIndexCache
+{
+private:
+    const TransactionStore &store;
+    std::vector<uint32_t> orders[CATEGORICAL_COLUMN_COUNT][2];
+    bool built[CATEGORICAL_COLUMN_COUNT][2] = {};
+
+    // Stable counting sort of rows [first, last) by rank
+    static std::vector<uint32_t> countingSort(const TransactionStore &store, CategoricalColumn column,
+                                              const std::vector<uint32_t> &rank, uint32_t first, uint32_t last)
+    {
+        uint32_t rankCount = rank.empty() ? 0 : *std::max_element(rank.begin(), rank.end()) + 1;
+        std::vector<uint32_t> offsets(rankCount + 1, 0);
+        for (uint32_t rowId = first; rowId < last; ++rowId)
+            ++offsets[rank[store.row(rowId)->codes[column]] + 1];
+        for (uint32_t r = 0; r < rankCount; ++r)
+            offsets[r + 1] += offsets[r];
+
+        std::vector<uint32_t> sorted(last - first);
+        for (uint32_t rowId = first; rowId < last; ++rowId)
+            sorted[offsets[rank[store.row(rowId)->codes[column]]]++] = rowId;
+        return sorted;
+    }
+
+public:
+    size_t builds = 0;  // permutations sorted from scratch
+    size_t patches = 0; // permutations extended with newly ingested rows
+    size_t hits = 0;    // requests answered without any sorting
+
+    explicit SortedIndexCache(const TransactionStore &store) : store(store) {}
+
+    const std::vector<uint32_t> &sorted(CategoricalColumn column, bool ignoreCase = false)
+    {
+        std::vector<uint32_t> &order = orders[column][ignoreCase];
+        uint32_t covered = static_cast<uint32_t>(order.size());
+        if (built[column][ignoreCase] && covered == store.size())
+        {
+            ++hits;
+            return order;
+        }
+
+        std::vector<uint32_t> rank = store.dictionary(column).sortedRanks(ignoreCase);
+        if (!built[column][ignoreCase])
+        {
+            order = countingSort(store, column, rank, 0, store.size());
+            built[column][ignoreCase] = true;
+            ++builds;
+            return order;
+        }
+
+        std::vector<uint32_t> fresh = countingSort(store, column, rank, covered, store.size());
+        order.insert(order.end(), fresh.begin(), fresh.end());
+        std::inplace_merge(order.begin(), order.begin() + covered, order.end(),
+                           [this, column, &rank](uint32_t a, uint32_t b)
+                           { return rank[store.row(a)->codes[column]] < rank[store.row(b)->codes[column]]; });
+        ++patches;
+        return order;
+    }
+
+    // Drops every cached order, e.g. after rows were changed in place
+    void invalidate()
+    {
+        for (int c = 0; c < CATEGORICAL_COLUMN_COUNT; ++c)
+        {
+            for (int fold = 0; fold < 2; ++fold)
+            {
+                orders[c][fold].clear();
+                orders[c][fold].shrink_to_fit();
+                built[c][fold] = false;
+            }
+        }
+    }
+
+    size_t memoryUsage() const
+    {
+        size_t total = 0;
+        for (int c = 0; c < CATEGORICAL_COLUMN_COUNT; ++c)
+            total += vectorHeapBytes(orders[c][0]) + vectorHeapBytes(orders[c][1]);
+        return total;
+    }
+};
+
+// Multi-key sorting. A sort is a list of SortKey<Field, Direction> types,
+// e.g. SortKey<CategoricalField<COL_LOCATION>>, SortKey<AmountField,
+// SORT_DESCENDING>, SortKey<TimestampField>; MultiKeyLess folds them into one
+// comparator at compile time, so every field access and comparison inlines.
+// Fields are built from the store once per sort and hand back a key that
+// orders like the column itself.
+enum SortDirection
+{
+    SORT_ASCENDING,
+    SORT_DESCENDING
+};
+
+// Compares order-preserving dictionary ranks instead of the decoded strings
+template <CategoricalColumn Column>
+struct CategoricalField
+{
+    std::vector<uint32_t> rank;
+    explicit CategoricalField(const TransactionStore &store) : rank(store.dictionary(Column).sortedRanks()) {}
+    uint32_t operator()(const Transaction *t) const { return rank[t->codes[Column]]; }
+};
+
+struct AmountField
+{
+    const NumericColumns &numbers;
+    explicit AmountField(const TransactionStore &store) : numbers(store.numbers()) {}
+    double operator()(const Transaction *t) const { return numbers.amount(t->row_id); }
+};
+
+struct TimestampField
+{
+    const NumericColumns &numbers;
+    explicit TimestampField(const TransactionStore &store) : numbers(store.numbers()) {}
+    int64_t operator()(const Transaction *t) const { return numbers.timestamp(t->row_id); }
+};
+
+template <ScoreColumn Column>
+struct ScoreField
+{
+    const NumericColumns &numbers;
+    explicit ScoreField(const TransactionStore &store) : numbers(store.numbers()) {}
+    double operator()(const Transaction *t) const { return numbers.score(Column, t->row_id); }
+};
+
+struct FraudField
+{
+    const NumericColumns &numbers;
+    explicit FraudField(const TransactionStore &store) : numbers(store.numbers()) {}
+    bool operator()(const Transaction *t) const { return numbers.isFraud(t->row_id); }
+};
+
+// Load order; useful as a last key to make any sort fully deterministic
+struct RowIdField
+{
+    explicit RowIdField(const TransactionStore &) {}
+    uint32_t operator()(const Transaction *t) const { return t->row_id; }
+};
+
+template <typename Field, SortDirection Direction = SORT_ASCENDING>
+struct SortKey
+{
+    Field field;
+    explicit SortKey(const TransactionStore &store) : field(store) {}
+
+    // -1, 0 or 1 as a sorts before, with or after b
+    int compare(const Transaction *a, const Transaction *b) const
+    {
+        auto x = field(a);
+        auto y = field(b);
+        int order = (x < y) ? -1 : (y < x) ? 1 : 0;
+        return Direction == SORT_ASCENDING ? order : -order;
+    }
+};
+
+template <typename... Keys>
+struct MultiKeyLess
+{
+    static_assert(sizeof...(Keys) > 0, "MultiKeyLess needs at least one key");
+    std::tuple<Keys...> keys;
+
+    explicit MultiKeyLess(const TransactionStore &store) : keys(Keys(store)...) {}
+
+    // Keys are tried in order; the first one that differs decides
+    bool operator()(const Transaction *a, const Transaction *b) const
+    {
+        int order = 0;
+        std::apply([&](const Keys &...key)
+                   { (void)(... || ((order = key.compare(a, b)) != 0)); },
+                   keys);
+        return order < 0;
+    }
+};
+
+void printRow(const TransactionStore &store, const Transaction *t)
+{
+    const TransactionDetails &d = store.detailsOf(t);
+    std::cout << d.transaction_id << "|"
+              << d.timestamp << "|"
+              << d.sender_account << "|"
+              << d.receiver_account << "|"
+              << store.amount(t) << "|"
+              << store.value(t, COL_PAYMENT_CHANNEL) << "|"
+              << store.value(t, COL_LOCATION) << "\n";
+}
+
+// Short "id | type | location" line used by the search results
+void printSearchHit(const TransactionStore &store, const Transaction *t)
+{
+    std::cout << store.detailsOf(t).transaction_id << " | "
+              << store.value(t, COL_TRANSACTION_TYPE) << " | "
+              << store.value(t, COL_LOCATION) << "\n";
+}
+
+void printPartitions(const TransactionStore &store, const PartitionIndex &index, int limit = 20)
+{
+    const Dictionary &dict = store.dictionary(index.column);
+    for (uint32_t code = 0; code < index.partitionCount(); ++code)
+    {
+        const std::string &value = dict.decode(code);
+        std::cout << "\n-- " << categoricalColumnName(index.column) << " = "
+                  << (value.empty() ? "(empty)" : value)
+                  << " (" << index.partitionSize(code) << " transactions) --\n";
+
+        int shown = 0;
+        for (const uint32_t *it = index.begin(code); it != index.end(code) && shown < limit; ++it, ++shown)
+            printRow(store, store.row(*it));
+    }
+}
+
+struct Node
+{
+    Transaction *data;
+    Node *next;
+};
+
+// Key a container is currently sorted by, as far as it knows
+enum ContainerOrder
+{
+    ORDER_UNKNOWN,
+    ORDER_BY_LOCATION, // sortByLocation: location, case-sensitive
+    ORDER_BY_TYPE      // sortByTransactionType: transaction type, case-folded
+};
+
+// How ensureSortedBy got a container into the requested order
+enum SortReuse
+{
+    SORT_REUSED,          // already in that order, nothing done
+    SORT_MERGED_APPENDED, // only the rows appended since the last sort were sorted and merged
+    SORT_FULL             // sorted (or laid out from the cache) from scratch
+};
+
+// Sort state kept by each container. Every method that reorders elements
+// records the resulting key; appends leave the sorted prefix alone and set
+// dirty. The version changes on every append or reorder, so callers can
+// tell whether an order they looked at earlier is still current.
+struct SortState
+{
+    ContainerOrder order = ORDER_UNKNOWN;
+    size_t appendedSinceSort = 0; // trailing elements not covered by `order`
+    bool dirty = false;
+    uint64_t version = 0;
+
+    void appended()
+    {
+        ++appendedSinceSort;
+        dirty = order != ORDER_UNKNOWN;
+        ++version;
+    }
+
+    void reordered(ContainerOrder key)
+    {
+        order = key;
+        appendedSinceSort = 0;
+        dirty = false;
+        ++version;
+    }
+};
+
+inline ContainerOrder orderOf(CategoricalColumn column, bool ignoreCase)
+{
+    if (column == COL_LOCATION && !ignoreCase)
+        return ORDER_BY_LOCATION;
+    if (column == COL_TRANSACTION_TYPE && ignoreCase)
+        return ORDER_BY_TYPE;
+    return ORDER_UNKNOWN;
+}
+
+// The dictionary column and case folding behind a known order
+inline CategoricalColumn orderColumn(ContainerOrder order, bool &ignoreCase)
+{
+    ignoreCase = order == ORDER_BY_TYPE;
+    return order == ORDER_BY_TYPE ? COL_TRANSACTION_TYPE : COL_LOCATION;
+}
+
+// First 8 bytes of a string as a big-endian integer, zero padded, so integer
+// order is byte-wise string order up to the eighth byte
+inline uint64_t normalizedPrefix(const std::string &value)
+{
+    uint64_t key = 0;
+    for (size_t i = 0; i < 8; ++i)
+        key = (key << 8) | (i < value.size() ? static_cast<unsigned char>(value[i]) : 0u);
+    return key;
+}
+
+// Stable sort of `items` by the string text(item) without string compares in
+// the common case. Each item gets its normalized 8-byte prefix, the prefixes
+// are LSD radix sorted (byte passes where every key has the same byte, such
+// as a shared "ACC" prefix, are skipped), and only runs of equal prefixes
+// whose strings may still differ (longer than 8 bytes, or of different
+// lengths) are re-sorted with full string comparisons.
+template <typename Item, typename Text>
+void normalizedPrefixSort(std::vector<Item> &items, Text text)
+{
+    struct Keyed
+    {
+        uint64_t prefix;
+        uint32_t position;
+    };
+    size_t n = items.size();
+    std::vector<Keyed> keys(n), scratch(n);
+    for (size_t i = 0; i < n; ++i)
+        keys[i] = Keyed{normalizedPrefix(text(items[i])), static_cast<uint32_t>(i)};
+
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        size_t count[257] = {};
+        for (const Keyed &k : keys)
+            ++count[((k.prefix >> shift) & 0xFF) + 1];
+        if (std::find(count + 1, count + 257, n) != count + 257)
+            continue;
+        for (int digit = 0; digit < 256; ++digit)
+            count[digit + 1] += count[digit];
+        for (const Keyed &k : keys)
+            scratch[count[(k.prefix >> shift) & 0xFF]++] = k;
+        keys.swap(scratch);
+    }
+
+    for (size_t lo = 0; lo < n;)
+    {
+        size_t hi = lo + 1;
+        size_t length = text(items[keys[lo].position]).size();
+        bool needFull = length > 8;
+        for (; hi < n && keys[hi].prefix == keys[lo].prefix; ++hi)
+        {
+            size_t other = text(items[keys[hi].position]).size();
+            needFull = needFull || other > 8 || other != length;
+        }
+        if (needFull && hi - lo > 1)
+            std::stable_sort(keys.begin() + lo, keys.begin() + hi, [&](const Keyed &a, const Keyed &b)
+                             { return text(items[a.position]) < text(items[b.position]); });
+        lo = hi;
+    }
+
+    std::vector<Item> sorted(n);
+    for (size_t i = 0; i < n; ++i)
+        sorted[i] = items[keys[i].position];
+    items.swap(sorted);
+}
+
+// TimSort's merge pattern for the adaptive sorts. Natural runs are pushed in
+// input order and adjacent runs merged until, from the top of the stack down,
+// every run is longer than the one above it and than the two above it
+// combined; that keeps merges balanced (O(n log n) worst case) while a single
+// long presorted run is never touched. `merge(a, b)` joins two neighbouring
+// runs; with `force` everything is merged down to one run.
+template <typename Run, typename Merge>
+void collapseRuns(std::vector<Run> &runs, Merge merge, bool force)
+{
+    while (runs.size() > 1)
+    {
+        size_t n = runs.size() - 2;
+        if (force)
+        {
+            if (n > 0 && runs[n - 1].length < runs[n + 1].length)
+                --n;
+        }
+        else if ((n > 0 && runs[n - 1].length <= runs[n].length + runs[n + 1].length) ||
+                 (n > 1 && runs[n - 2].length <= runs[n - 1].length + runs[n].length))
+        {
+            if (runs[n - 1].length < runs[n + 1].length)
+                --n;
+        }
+        else if (runs[n].length > runs[n + 1].length)
+            break;
+
+        runs[n] = merge(runs[n], runs[n + 1]);
+        runs.erase(runs.begin() + n + 1);
+    }
+}
+
+class TransactionList
+{
+private:
+    const TransactionStore &store;
+    Node *head;
+    Node *tail;
+    SortState state;
+    Node *sortedTail = nullptr; // last node covered by the last sort, see ensureSortedBy
+    size_t nodeCount = 0;
+
+    // Optional skip-list layer in `skipKey` order. Level 0 is the list itself;
+    // a node gets an express tower of h >= 1 levels with probability 4^-h.
+    // insertSorted keeps the layer current; any other change to the list
+    // makes it stale and it is rebuilt on the next skip-list call.
+    struct SkipTower
+    {
+        Node *node;
+        std::vector<SkipTower *> next; // next tower on each express level
+    };
+    ContainerOrder skipKey = ORDER_UNKNOWN;
+    std::vector<std::unique_ptr<SkipTower>> towers;
+    std::vector<SkipTower *> skipHeads; // first tower on each express level
+    uint64_t skipVersion = UINT64_MAX;  // state.version the layer matches
+    std::mt19937 skipRandom{SKIP_LIST_SEED};
+
+    void reordered(ContainerOrder key)
+    {
+        state.reordered(key);
+        sortedTail = tail;
+    }
+
+    const std::string &skipKeyOf(const Transaction *t) const
+    {
+        bool ignoreCase;
+        CategoricalColumn column = orderColumn(skipKey, ignoreCase);
+        return ignoreCase ? store.foldedValue(t, column) : store.value(t, column);
+    }
+
+    int randomSkipHeight()
+    {
+        int height = 0;
+        while (height < SKIP_LIST_MAX_LEVEL && (skipRandom() & 3) == 0)
+            ++height;
+        return height;
+    }
+
+    // Gives `node` a tower of `height` levels after the towers in `update`
+    void linkTower(Node *node, int height, SkipTower **update)
+    {
+        towers.push_back(std::unique_ptr<SkipTower>(new SkipTower{node, std::vector<SkipTower *>(height, nullptr)}));
+        SkipTower *tower = towers.back().get();
+        for (int level = 0; level < height; ++level)
+        {
+            SkipTower *&link = update[level] ? update[level]->next[level] : skipHeads[level];
+            tower->next[level] = link;
+            link = tower;
+        }
+    }
+
+    // Sorts the list by the skip key if needed and rebuilds the towers in one
+    // pass. Without enableSkipIndex the key is the order the list was last
+    // sorted in; false if it never was, since there is no order to keep.
+    bool ensureSkipLayer()
+    {
+        if (skipKey == ORDER_UNKNOWN)
+        {
+            if (state.order == ORDER_UNKNOWN)
+            {
+                std::cerr << "[ERROR] Skip index has no key: call enableSkipIndex or sort the list first.\n";
+                return false;
+            }
+            skipKey = state.order;
+            skipVersion = UINT64_MAX;
+        }
+        if (skipVersion == state.version)
+            return true;
+
+        ensureSortedBy(skipKey);
+        towers.clear();
+        skipHeads.assign(SKIP_LIST_MAX_LEVEL, nullptr);
+        skipRandom.seed(SKIP_LIST_SEED);
+        SkipTower *last[SKIP_LIST_MAX_LEVEL] = {};
+        for (Node *curr = head; curr; curr = curr->next)
+        {
+            int height = randomSkipHeight();
+            if (height == 0)
+                continue;
+            linkTower(curr, height, last);
+            for (int level = 0; level < height; ++level)
+                last[level] = towers.back().get();
+        }
+        skipVersion = state.version;
+        return true;
+    }
+
+    // Descends the express levels to the last tower whose key is below `key`
+    // (or not above it, with `orEqual`), noting that tower per level in `update`
+    SkipTower *skipDescend(const std::string &key, bool orEqual, SkipTower **update) const
+    {
+        SkipTower *pred = nullptr;
+        for (int level = SKIP_LIST_MAX_LEVEL - 1; level >= 0; --level)
+        {
+            SkipTower *next = pred ? pred->next[level] : skipHeads[level];
+            while (next && (orEqual ? skipKeyOf(next->node->data) <= key : skipKeyOf(next->node->data) < key))
+            {
+                pred = next;
+                next = pred->next[level];
+            }
+            if (update)
+                update[level] = pred;
+        }
+        return pred;
+    }
+
+    // Iterative bottom-up merge sort. Each pass walks the list once, merging
+    // neighbouring runs of `width` nodes by relinking them, then doubles the
+    // width; no recursion and O(1) extra space. Equal keys keep their order.
+    template <typename Less>
+    void bottomUpMergeSort(Less less)
+    {
+        if (!head || !head->next)
+            return;
+
+        for (size_t width = 1;; width *= 2)
+        {
+            Node *remaining = head;
+            Node *mergedHead = nullptr;
+            Node *mergedTail = nullptr;
+            size_t merges = 0;
+
+            while (remaining)
+            {
+                ++merges;
+                Node *left = remaining;
+                Node *right = remaining;
+                size_t leftSize = 0;
+                while (right && leftSize < width)
+                {
+                    right = right->next;
+                    ++leftSize;
+                }
+                size_t rightSize = width;
+
+                while (leftSize > 0 || (rightSize > 0 && right))
+                {
+                    Node *next;
+                    if (leftSize == 0 || (rightSize > 0 && right && less(right->data, left->data)))
+                    {
+                        next = right;
+                        right = right->next;
+                        --rightSize;
+                    }
+                    else
+                    {
+                        next = left;
+                        left = left->next;
+                        --leftSize;
+                    }
+
+                    if (mergedTail)
+                        mergedTail->next = next;
+                    else
+                        mergedHead = next;
+                    mergedTail = next;
+                }
+                remaining = right;
+            }
+
+            mergedTail->next = nullptr;
+            head = mergedHead;
+            tail = mergedTail;
+            if (merges <= 1)
+                return;
+        }
+    }
+
+    struct ListRun
+    {
+        Node *head;
+        Node *tail;
+        size_t length;
+    };
+
+    // Stable merge of two detached runs. If they are already in order it is a
+    // single link; otherwise each side hands over the whole chain of nodes that
+    // precede the other side's head, which are already linked, so only one
+    // pointer per chain is rewritten (the list form of TimSort's galloping).
+    template <typename Less>
+    static ListRun mergeRuns(const ListRun &a, const ListRun &b, Less &less)
+    {
+        if (!less(b.head->data, a.tail->data))
+        {
+            a.tail->next = b.head;
+            return ListRun{a.head, b.tail, a.length + b.length};
+        }
+
+        Node dummy{nullptr, nullptr};
+        Node *out = &dummy;
+        Node *x = a.head;
+        Node *y = b.head;
+        while (x && y)
+        {
+            Node *last;
+            if (less(y->data, x->data))
+            {
+                for (last = y; last->next && less(last->next->data, x->data); last = last->next)
+                    ;
+                out->next = y;
+                y = last->next;
+            }
+            else
+            {
+                for (last = x; last->next && !less(y->data, last->next->data); last = last->next)
+                    ;
+                out->next = x;
+                x = last->next;
+            }
+            out = last;
+        }
+        out->next = x ? x : y;
+        return ListRun{dummy.next, x ? a.tail : b.tail, a.length + b.length};
+    }
+
+public:
+    // Adaptive stable sort: the list is cut into natural runs (non-decreasing,
+    // or strictly decreasing and relinked in reverse) which are merged with
+    // TimSort's run-stack rule. Already sorted input is one run and costs n-1
+    // comparisons; a sorted list with a short unsorted tail costs little more.
+    template <typename Less>
+    void naturalMergeSort(Less less)
+    {
+        if (!head || !head->next)
+        {
+            reordered(ORDER_UNKNOWN);
+            return;
+        }
+
+        std::vector<ListRun> runs;
+        auto merge = [&less](const ListRun &a, const ListRun &b)
+        { return mergeRuns(a, b, less); };
+
+        Node *curr = head;
+        while (curr)
+        {
+            ListRun run{curr, curr, 1};
+            Node *next = curr->next;
+            if (next && less(next->data, curr->data))
+            {
+                // Strictly decreasing: prepend each node, reversing the run
+                run.head->next = nullptr;
+                while (next && less(next->data, run.head->data))
+                {
+                    Node *after = next->next;
+                    next->next = run.head;
+                    run.head = next;
+                    ++run.length;
+                    next = after;
+                }
+            }
+            else
+            {
+                while (next && !less(next->data, run.tail->data))
+                {
+                    run.tail = next;
+                    ++run.length;
+                    next = next->next;
+                }
+                run.tail->next = nullptr;
+            }
+            curr = next;
+            runs.push_back(run);
+            collapseRuns(runs, merge, false);
+        }
+        collapseRuns(runs, merge, true);
+
+        head = runs[0].head;
+        tail = runs[0].tail;
+        tail->next = nullptr;
+        reordered(ORDER_UNKNOWN);
+    }
+
+    // Stable comparison sort with any comparator
+    template <typename Less>
+    void mergeSort(Less less)
+    {
+        bottomUpMergeSort(less);
+        reordered(ORDER_UNKNOWN);
+    }
+
+    // Stable sort on the string text(transaction), see normalizedPrefixSort
+    template <typename Text>
+    void prefixKeySort(Text text)
+    {
+        std::vector<Node *> nodes;
+        for (Node *curr = head; curr; curr = curr->next)
+            nodes.push_back(curr);
+        normalizedPrefixSort(nodes, [&text](const Node *node) -> const std::string &
+                             { return text(node->data); });
+
+        head = tail = nullptr;
+        for (Node *node : nodes)
+        {
+            if (tail)
+                tail->next = node;
+            else
+                head = node;
+            tail = node;
+        }
+        if (tail)
+            tail->next = nullptr;
+        reordered(ORDER_UNKNOWN);
+    }
+
+    explicit TransactionList(const TransactionStore &store) : store(store), head(nullptr), tail(nullptr) {}
+    TransactionList(const TransactionList &) = delete;
+    TransactionList &operator=(const TransactionList &) = delete;
+
+    void append(Transaction *t)
+    {
+        Node *newNode = new Node{t, nullptr};
+        if (!head)
+        {
+            head = tail = newNode;
+        }
+        else
+        {
+            tail->next = newNode;
+            tail = newNode;
+        }
+        ++nodeCount;
+        state.appended();
+    }
+
+    void print(int limit = 20) const
+    {
+        Node *temp = head;
+        int count = 0;
+
+        while (temp && count < limit)
+        {
+            printRow(store, temp->data);
+            temp = temp->next;
+            ++count;
+        }
+    }
+
+    // Stable LSD radix sort on the dictionary rank of `column`, 8 bits per pass.
+    // Nodes are dealt into 256 bucket chains and the chains relinked in order;
+    // passes above the highest rank's top byte are skipped, so a column with
+    // fewer than 256 distinct values sorts in a single counting pass.
+    void radixSortBy(CategoricalColumn column, bool ignoreCase = false)
+    {
+        if (!head || !head->next)
+        {
+            reordered(orderOf(column, ignoreCase));
+            return;
+        }
+
+        std::vector<uint32_t> rank = store.dictionary(column).sortedRanks(ignoreCase);
+        uint32_t maxRank = rank.empty() ? 0 : *std::max_element(rank.begin(), rank.end());
+        Node *bucketHead[256];
+        Node *bucketTail[256];
+
+        for (int shift = 0; shift == 0 || (shift < 32 && (maxRank >> shift) != 0); shift += 8)
+        {
+            std::fill(bucketHead, bucketHead + 256, nullptr);
+            for (Node *curr = head; curr; curr = curr->next)
+            {
+                uint32_t digit = (rank[curr->data->codes[column]] >> shift) & 0xFF;
+                if (bucketHead[digit])
+                    bucketTail[digit]->next = curr;
+                else
+                    bucketHead[digit] = curr;
+                bucketTail[digit] = curr;
+            }
+
+            head = tail = nullptr;
+            for (int digit = 0; digit < 256; ++digit)
+            {
+                if (!bucketHead[digit])
+                    continue;
+                if (tail)
+                    tail->next = bucketHead[digit];
+                else
+                    head = bucketHead[digit];
+                tail = bucketTail[digit];
+            }
+            tail->next = nullptr;
+        }
+        reordered(orderOf(column, ignoreCase));
+    }
+
+    // Stable sort on a list of SortKey types, see MultiKeyLess
+    template <typename... Keys>
+    void sortBy()
+    {
+        MultiKeyLess<Keys...> less(store);
+        bottomUpMergeSort([&less](const Transaction *a, const Transaction *b)
+                          { return less(a, b); });
+        reordered(ORDER_UNKNOWN);
+    }
+
+    void sortByTransactionType(TypeSortMode mode = TYPE_SORT_PRECOMPUTED_KEY)
+    {
+        if (mode == TYPE_SORT_RADIX)
+        {
+            radixSortBy(COL_TRANSACTION_TYPE, true);
+        }
+        else if (mode == TYPE_SORT_FOLD_PER_COMPARE)
+        {
+            bottomUpMergeSort([this](const Transaction *a, const Transaction *b)
+                              { return compareIgnoreCase(store.value(a, COL_TRANSACTION_TYPE), store.value(b, COL_TRANSACTION_TYPE)) < 0; });
+        }
+        else
+        {
+            // The merge sort already relinks in place, so the folded key is just
+            // looked up per node instead of being materialized into pairs
+            std::vector<uint32_t> rank = store.dictionary(COL_TRANSACTION_TYPE).sortedRanks(true);
+            bottomUpMergeSort([&rank](const Transaction *a, const Transaction *b)
+                              { return rank[a->codes[COL_TRANSACTION_TYPE]] < rank[b->codes[COL_TRANSACTION_TYPE]]; });
+        }
+        reordered(ORDER_BY_TYPE);
+    }
+
+    void sortByLocation(SortAlgorithm algorithm = SORT_COMPARISON)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        if (algorithm == SORT_RADIX)
+            radixSortBy(COL_LOCATION);
+        else if (algorithm == SORT_ADAPTIVE)
+            naturalMergeSort([this](const Transaction *a, const Transaction *b)
+                             { return store.value(a, COL_LOCATION) < store.value(b, COL_LOCATION); });
+        else if (algorithm == SORT_PREFIX_KEY)
+            prefixKeySort([this](const Transaction *t) -> const std::string &
+                          { return store.value(t, COL_LOCATION); });
+        else
+            bottomUpMergeSort([this](const Transaction *a, const Transaction *b)
+                              { return store.value(a, COL_LOCATION) < store.value(b, COL_LOCATION); });
+        reordered(ORDER_BY_LOCATION);
+        auto end = std::chrono::high_resolution_clock::now();
+
+    }
+
+
+    // Turns on the skip-list layer for `key`; the list is sorted by it and
+    // the towers built on the next skip-list call
+    void enableSkipIndex(ContainerOrder key)
+    {
+        if (key == skipKey)
+            return;
+        skipKey = key;
+        skipVersion = UINT64_MAX;
+    }
+
+    // Calls `visit` on every transaction whose skip key equals `value`, in list
+    // order: expected O(log n) to the first match, then one step per match
+    template <typename Visit>
+    size_t skipSearch(const std::string &value, Visit visit)
+    {
+        if (!ensureSkipLayer())
+            return 0;
+        bool ignoreCase;
+        orderColumn(skipKey, ignoreCase);
+        std::string key = ignoreCase ? toLower(value) : value;
+
+        SkipTower *pred = skipDescend(key, false, nullptr);
+        Node *curr = pred ? pred->node->next : head;
+        while (curr && skipKeyOf(curr->data) < key)
+            curr = curr->next;
+
+        size_t matches = 0;
+        for (; curr && skipKeyOf(curr->data) == key; curr = curr->next, ++matches)
+            visit(curr->data);
+        return matches;
+    }
+
+    // Inserts `t` after the nodes with an equal skip key, keeping the list in
+    // order without re-sorting it. Refuses (false, `t` not inserted) when the
+    // skip layer has no key, see ensureSkipLayer.
+    bool insertSorted(Transaction *t)
+    {
+        if (!ensureSkipLayer())
+            return false;
+        const std::string &key = skipKeyOf(t);
+        SkipTower *update[SKIP_LIST_MAX_LEVEL];
+        SkipTower *pred = skipDescend(key, true, update);
+        Node *before = pred ? pred->node : nullptr;
+        Node *after = before ? before->next : head;
+        while (after && skipKeyOf(after->data) <= key)
+        {
+            before = after;
+            after = after->next;
+        }
+
+        Node *node = new Node{t, after};
+        if (before)
+            before->next = node;
+        else
+            head = node;
+        if (!after)
+            tail = node;
+        ++nodeCount;
+
+        int height = randomSkipHeight();
+        if (height > 0)
+            linkTower(node, height, update);
+        reordered(skipKey);
+        skipVersion = state.version;
+        return true;
+    }
+
+    void skipSearchTransactionType(const std::string &type)
+    {
+        enableSkipIndex(ORDER_BY_TYPE);
+        size_t found = skipSearch(type, [this](const Transaction *t) { printSearchHit(store, t); });
+        if (found == 0)
+            std::cout << "[INFO] No transactions found for type: " << type << "\n";
+    }
+
+    Node *getHead() const { return head; }
+    Node *getTail() const { return tail; }
+
+    const SortState &sortState() const { return state; }
+
+    // Brings the list into `key` order as cheaply as its sort state allows:
+    // nothing if it is already sorted by `key`, a sort of just the appended
+    // nodes merged into the sorted prefix if only appends happened since, and
+    // otherwise a full layout from `cache` (or a full sort without one)
+    SortReuse ensureSortedBy(ContainerOrder key, SortedIndexCache *cache = nullptr)
+    {
+        bool ignoreCase;
+        CategoricalColumn column = orderColumn(key, ignoreCase);
+        if (state.order == key && !state.dirty)
+            return SORT_REUSED;
+
+        if (state.order == key && sortedTail)
+        {
+            std::vector<uint32_t> rank = store.dictionary(column).sortedRanks(ignoreCase);
+            auto less = [&rank, column](const Transaction *a, const Transaction *b)
+            { return rank[a->codes[column]] < rank[b->codes[column]]; };
+
+            std::vector<Node *> appendedNodes;
+            for (Node *curr = sortedTail->next; curr; curr = curr->next)
+                appendedNodes.push_back(curr);
+            std::stable_sort(appendedNodes.begin(), appendedNodes.end(), [&less](const Node *a, const Node *b)
+                             { return less(a->data, b->data); });
+            for (size_t i = 0; i + 1 < appendedNodes.size(); ++i)
+                appendedNodes[i]->next = appendedNodes[i + 1];
+            appendedNodes.back()->next = nullptr;
+            sortedTail->next = nullptr;
+
+            ListRun merged = mergeRuns(ListRun{head, sortedTail, 0},
+                                       ListRun{appendedNodes.front(), appendedNodes.back(), appendedNodes.size()}, less);
+            head = merged.head;
+            tail = merged.tail;
+            reordered(key);
+            return SORT_MERGED_APPENDED;
+        }
+
+        if (cache)
+            applyOrder(cache->sorted(column, ignoreCase));
+        else if (key == ORDER_BY_TYPE)
+            sortByTransactionType();
+        else
+            sortByLocation();
+        reordered(key);
+        return SORT_FULL;
+    }
+
+    // Relinks the nodes into the order of `rowIds` (e.g. a SortedIndexCache
+    // permutation) without comparing anything. Nodes sharing a row stay
+    // together in list order, rows not in the list and repeated row ids are
+    // skipped, and nodes whose row is missing from `rowIds` follow the listed
+    // ones in their original order, so no node is ever dropped.
+    void applyOrder(const std::vector<uint32_t> &rowIds)
+    {
+        std::vector<Node *> original;
+        original.reserve(nodeCount);
+        for (Node *curr = head; curr; curr = curr->next)
+            original.push_back(curr);
+
+        // firstOf[row] -> first position holding the row, sameRow[pos] -> next one
+        std::vector<uint32_t> firstOf(store.size(), UINT32_MAX);
+        std::vector<uint32_t> sameRow(original.size(), UINT32_MAX);
+        for (uint32_t pos = static_cast<uint32_t>(original.size()); pos-- > 0;)
+        {
+            uint32_t rowId = original[pos]->data->row_id;
+            sameRow[pos] = firstOf[rowId];
+            firstOf[rowId] = pos;
+        }
+
+        head = tail = nullptr;
+        nodeCount = 0;
+        std::vector<bool> linked(original.size(), false);
+        auto link = [&](uint32_t pos)
+        {
+            Node *node = original[pos];
+            linked[pos] = true;
+            ++nodeCount;
+            if (tail)
+                tail->next = node;
+            else
+                head = node;
+            tail = node;
+        };
+        for (uint32_t rowId : rowIds)
+        {
+            if (rowId >= firstOf.size())
+                continue;
+            for (uint32_t pos = firstOf[rowId]; pos != UINT32_MAX; pos = sameRow[pos])
+                link(pos);
+            firstOf[rowId] = UINT32_MAX;
+        }
+        for (uint32_t pos = 0; pos < original.size(); ++pos)
+        {
+            if (!linked[pos])
+                link(pos);
+        }
+        if (tail)
+            tail->next = nullptr;
+        reordered(ORDER_UNKNOWN);
+    }
+
+    // Heap bytes of the nodes and the skip-list layer; the transactions
+    // themselves belong to the store
+    size_t memoryUsage() const
+    {
+        size_t total = nodeCount * heapBlockBytes(sizeof(Node)) + vectorHeapBytes(towers) +
+                       towers.size() * heapBlockBytes(sizeof(SkipTower)) + vectorHeapBytes(skipHeads);
+        for (const auto &tower : towers)
+            total += vectorHeapBytes(tower->next);
+        return total;
+    }
+
+    // Kept up to date by append, insertSorted and applyOrder, so O(1)
+    int countNodes() const { return static_cast<int>(nodeCount); }
+
+    long long benchmarkOperation() const
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        volatile double sink = 0.0; // keeps the loads from being optimized away
+        Node *temp = head;
+        while (temp)
+        {
+            sink = sink + store.amount(temp->data) * 2.0;
+            temp = temp->next;
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        long long elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        std::cout << "Traversal benchmark (Linked List): " << elapsed << " ns\n";
+        return elapsed;
+    }
+
+    // Equality lookups go through the store's hash index: one probe plus the
+    // matching rows, with no walk over the nodes
+    void searchTransactionType(const std::string &type) const
+    {
+        const std::vector<uint32_t> &rowIds = store.hashIndex(COL_TRANSACTION_TYPE).lookup(type);
+        std::cout << "Searching for transaction type: " << type << "\n";
+        for (uint32_t rowId : rowIds)
+            printSearchHit(store, store.row(rowId));
+        if (rowIds.empty())
+            std::cout << "[INFO] No transactions found for type: " << type << "\n";
+    }
+
+    // Walks every node, so the container comparison measures the list itself;
+    // the index lookup is timed separately by benchmarkIndexSearch
+    long long benchmarkSearch(const std::string &type) const
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<uint32_t> codes = store.dictionary(COL_TRANSACTION_TYPE).lookupIgnoreCase(type);
+
+        Node *temp = head;
+        while (temp)
+        {
+            if (std::find(codes.begin(), codes.end(), temp->data->codes[COL_TRANSACTION_TYPE]) != codes.end())
+            {
+                volatile auto tmp = store.amount(temp->data);
+            }
+            temp = temp->next;
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    }
+
+    ~TransactionList()
+    {
+        Node *temp = head;
+        while (temp)
+        {
+            Node *toDelete = temp;
+            temp = temp->next;
+            delete toDelete;
+        }
+    }
+};
+
+class TransactionArray
+{
+private:
+    const TransactionStore &store;
+    Transaction **data;
+    int size;
+    int capacity;
+    SortState state;
+
+    // Number of elements taken from run a when the stable merge of a[0..na)
+    // and b[0..nb) has emitted its first k elements. Ties go to a, matching
+    // std::merge, so merges can be cut at any k and run independently.
+    template <typename Less>
+    static int mergePathSplit(Transaction *const *a, int na, Transaction *const *b, int nb, int k, Less less)
+    {
+        int lo = std::max(0, k - nb);
+        int hi = std::min(k, na);
+        while (lo < hi)
+        {
+            int i = (lo + hi) / 2;
+            if (!less(b[k - i - 1], a[i]))
+                lo = i + 1;
+            else
+                hi = i;
+        }
+        return lo;
+    }
+
+    template <typename Less>
+    void insertionSort(int begin, int end, Less less)
+    {
+        for (int i = begin + 1; i < end; ++i)
+        {
+            Transaction *t = data[i];
+            int j = i;
+            for (; j > begin && less(t, data[j - 1]); --j)
+                data[j] = data[j - 1];
+            data[j] = t;
+        }
+    }
+
+    struct ArrayRun
+    {
+        int base;
+        int length;
+    };
+
+    // Insertion point of key in the sorted range [first, last): the upper bound
+    // if `upper`, else the lower bound. Probes offsets 1, 3, 7, 15, ... before
+    // binary searching, so the cost is O(log d) for an answer d from `first`.
+    template <typename Less>
+    static Transaction **gallop(Transaction *key, Transaction **first, Transaction **last, bool upper, Less &less)
+    {
+        ptrdiff_t n = last - first;
+        ptrdiff_t known = 0; // first[0 .. known) all belong before key
+        ptrdiff_t step = 1;
+        while (step <= n && (upper ? !less(key, first[step - 1]) : less(first[step - 1], key)))
+        {
+            known = step;
+            step = step * 2 + 1;
+        }
+        Transaction **end = first + std::min(step, n);
+        return upper ? std::upper_bound(first + known, end, key, less)
+                     : std::lower_bound(first + known, end, key, less);
+    }
+
+    // Length of the natural run starting at lo; a strictly decreasing run is
+    // reversed in place (strictness keeps the reversal stable)
+    template <typename Less>
+    int naturalRun(int lo, Less &less)
+    {
+        int hi = lo + 1;
+        if (hi == size)
+            return 1;
+        if (less(data[hi], data[lo]))
+        {
+            while (hi + 1 < size && less(data[hi + 1], data[hi]))
+                ++hi;
+            std::reverse(data + lo, data + hi + 1);
+        }
+        else
+        {
+            while (hi + 1 < size && !less(data[hi + 1], data[hi]))
+                ++hi;
+        }
+        return hi + 1 - lo;
+    }
+
+    // Stable merge of two adjacent runs. The left run's prefix that already
+    // precedes the right run, and the right run's suffix that already follows
+    // the left run, are found by galloping and left where they are. The rest
+    // is merged through a copy of the left part; once one side wins minGallop
+    // times in a row the merge switches to copying whole blocks found by
+    // galloping, and minGallop adapts to how well that pays off.
+    template <typename Less>
+    ArrayRun mergeArrayRuns(const ArrayRun &a, const ArrayRun &b, std::vector<Transaction *> &buffer,
+                            int &minGallop, Less &less)
+    {
+        ArrayRun merged{a.base, a.length + b.length};
+        Transaction **left = gallop(data[b.base], data + a.base, data + b.base, true, less);
+        Transaction **leftEnd = data + b.base;
+        Transaction **right = data + b.base;
+        Transaction **rightEnd = gallop(leftEnd[-1], right, data + b.base + b.length, false, less);
+        if (left == leftEnd || right == rightEnd)
+            return merged;
+
+        Transaction **dest = left;
+        buffer.assign(left, leftEnd);
+        left = buffer.data();
+        leftEnd = left + buffer.size();
+
+        int leftWins = 0, rightWins = 0;
+        while (left < leftEnd && right < rightEnd)
+        {
+            if (less(*right, *left))
+            {
+                *dest++ = *right++;
+                ++rightWins;
+                leftWins = 0;
+            }
+            else
+            {
+                *dest++ = *left++;
+                ++leftWins;
+                rightWins = 0;
+            }
+            if (leftWins < minGallop && rightWins < minGallop)
+                continue;
+
+            while (left < leftEnd && right < rightEnd)
+            {
+                Transaction **stop = gallop(*right, left, leftEnd, true, less);
+                ptrdiff_t leftBlock = stop - left;
+                dest = std::copy(left, stop, dest);
+                left = stop;
+                if (left == leftEnd)
+                    break;
+
+                stop = gallop(*left, right, rightEnd, false, less);
+                ptrdiff_t rightBlock = stop - right;
+                dest = std::copy(right, stop, dest);
+                right = stop;
+
+                if (leftBlock < MIN_GALLOP && rightBlock < MIN_GALLOP)
+                {
+                    ++minGallop;
+                    break;
+                }
+                minGallop = std::max(1, minGallop - 1);
+            }
+            leftWins = rightWins = 0;
+        }
+        // Whatever is left of the right run is already in place
+        std::copy(left, leftEnd, dest);
+        return merged;
+    }
+
+    // Orders data[a] <= data[b] <= data[c]
+    template <typename Less>
+    void sort3(int a, int b, int c, Less less)
+    {
+        if (less(data[b], data[a]))
+            std::swap(data[a], data[b]);
+        if (less(data[c], data[b]))
+            std::swap(data[b], data[c]);
+        if (less(data[b], data[a]))
+            std::swap(data[a], data[b]);
+    }
+
+    // pdqsort-style introsort. Each round picks a median-of-3 (ninther above
+    // 128 rows) pivot and does a three-way partition, so runs of equal keys are
+    // finished in one pass instead of being split again and again. The smaller
+    // side recurses and the larger side loops, bounding the stack at log2(n).
+    // A partition leaving less than 1/8 on one side counts as bad: it shuffles
+    // a few elements to break the input pattern, and once badAllowed is spent
+    // the range is heapsorted, keeping the worst case O(n log n).
+    template <typename Less>
+    void introSortRange(int begin, int end, int badAllowed, Less less)
+    {
+        while (end - begin > INSERTION_SORT_THRESHOLD)
+        {
+            int n = end - begin;
+            int mid = begin + n / 2;
+            if (n > 128)
+            {
+                sort3(begin, mid, end - 1, less);
+                sort3(begin + 1, mid - 1, end - 2, less);
+                sort3(begin + 2, mid + 1, end - 3, less);
+                sort3(mid - 1, mid, mid + 1, less);
+            }
+            else
+                sort3(begin, mid, end - 1, less);
+
+            Transaction *pivot = data[mid];
+            int lt = begin, i = begin, gt = end;
+            while (i < gt)
+            {
+                if (less(data[i], pivot))
+                    std::swap(data[lt++], data[i++]);
+                else if (less(pivot, data[i]))
+                    std::swap(data[i], data[--gt]);
+                else
+                    ++i;
+            }
+
+            int leftSize = lt - begin;
+            int rightSize = end - gt;
+            if (std::min(leftSize, rightSize) < n / 8 && std::max(leftSize, rightSize) > n / 2)
+            {
+                if (--badAllowed == 0)
+                {
+                    std::make_heap(data + begin, data + end, less);
+                    std::sort_heap(data + begin, data + end, less);
+                    return;
+                }
+                if (leftSize > INSERTION_SORT_THRESHOLD)
+                {
+                    std::swap(data[begin], data[begin + leftSize / 4]);
+                    std::swap(data[lt - 1], data[lt - leftSize / 4]);
+                }
+                if (rightSize > INSERTION_SORT_THRESHOLD)
+                {
+                    std::swap(data[gt], data[gt + rightSize / 4]);
+                    std::swap(data[end - 1], data[end - rightSize / 4]);
+                }
+            }
+
+            if (leftSize < rightSize)
+            {
+                introSortRange(begin, lt, badAllowed, less);
+                begin = gt;
+            }
+            else
+            {
+                introSortRange(gt, end, badAllowed, less);
+                end = lt;
+            }
+        }
+        insertionSort(begin, end, less);
+    }
+
+public:
+    explicit TransactionArray(const TransactionStore &store, int initialSize = MAX_TRANSACTIONS)
+        : store(store), size(0), capacity(initialSize)
+    {
+        data = new Transaction *[capacity];
+    }
+
+    TransactionArray(const TransactionArray &) = delete;
+    TransactionArray &operator=(const TransactionArray &) = delete;
+
+    ~TransactionArray()
+    {
+        delete[] data;
+    }
+
+    Transaction **getData() const { return data; }
+    int getSize() const { return size; }
+
+    const SortState &sortState() const { return state; }
+
+    // Brings the array into `key` order as cheaply as its sort state allows:
+    // nothing if it is already sorted by `key`, a sort of just the appended
+    // tail merged into the sorted prefix if only inserts happened since, and
+    // otherwise a full layout from `cache` (or a full sort without one)
+    SortReuse ensureSortedBy(ContainerOrder key, SortedIndexCache *cache = nullptr)
+    {
+        bool ignoreCase;
+        CategoricalColumn column = orderColumn(key, ignoreCase);
+        if (state.order == key && !state.dirty)
+            return SORT_REUSED;
+
+        if (state.order == key)
+        {
+            std::vector<uint32_t> rank = store.dictionary(column).sortedRanks(ignoreCase);
+            auto less = [&rank, column](const Transaction *a, const Transaction *b)
+            { return rank[a->codes[column]] < rank[b->codes[column]]; };
+            Transaction **appended = data + size - state.appendedSinceSort;
+            std::stable_sort(appended, data + size, less);
+            std::inplace_merge(data, appended, data + size, less);
+            state.reordered(key);
+            return SORT_MERGED_APPENDED;
+        }
+
+        if (cache)
+            applyOrder(cache->sorted(column, ignoreCase));
+        else if (key == ORDER_BY_TYPE)
+            sortByTransactionType();
+        else
+            sortByLocation();
+        state.reordered(key);
+        return SORT_FULL;
+    }
+
+    // Rewrites the pointer table in the order of `rowIds` (e.g. a
+    // SortedIndexCache permutation), matching TransactionList::applyOrder:
+    // every copy of a listed row goes at that row's position, rows not in the
+    // array and repeated row ids are skipped, and rows missing from `rowIds`
+    // follow in their original order, so the array keeps exactly its rows
+    void applyOrder(const std::vector<uint32_t> &rowIds)
+    {
+        state.reordered(ORDER_UNKNOWN);
+        std::vector<Transaction *> original(data, data + size);
+        std::vector<uint32_t> copies(store.size(), 0);
+        for (int i = 0; i < size; ++i)
+            ++copies[data[i]->row_id];
+
+        int next = 0;
+        for (uint32_t rowId : rowIds)
+        {
+            if (rowId >= copies.size())
+                continue;
+            for (; copies[rowId] > 0; --copies[rowId])
+                data[next++] = store.row(rowId);
+        }
+        for (Transaction *t : original)
+        {
+            if (copies[t->row_id] > 0)
+            {
+                --copies[t->row_id];
+                data[next++] = t;
+            }
+        }
+    }
+
+    // Heap bytes of the pointer array, which is allocated at full capacity up front
+    size_t memoryUsage() const { return heapBlockBytes(capacity * sizeof(Transaction *)); }
+
+    void insert(Transaction *t)
+    {
+        if (size == capacity)
+        {
+            std::cerr << "[ERROR] Max array capacity reached. Aborting load.\n";
+            exit(EXIT_FAILURE);
+        }
+        data[size++] = t;
+        state.appended();
+    }
+
+    // TimSort-style adaptive stable sort. Natural runs (reversed if strictly
+    // decreasing) shorter than minRun are extended to minRun by binary
+    // insertion sort, then merged with collapseRuns' run-stack rule through
+    // mergeArrayRuns. Sorted input is one run and costs n-1 comparisons; data
+    // that is sorted apart from a few appended or displaced rows stays close
+    // to O(n).
+    template <typename Less>
+    void adaptiveSort(Less less)
+    {
+        state.reordered(ORDER_UNKNOWN);
+        if (size < 2)
+            return;
+
+        int minRun = size;
+        int oddBits = 0;
+        while (minRun >= 64)
+        {
+            oddBits |= minRun & 1;
+            minRun >>= 1;
+        }
+        minRun += oddBits;
+
+        std::vector<ArrayRun> runs;
+        std::vector<Transaction *> buffer;
+        int minGallop = MIN_GALLOP;
+        auto merge = [&](const ArrayRun &a, const ArrayRun &b)
+        { return mergeArrayRuns(a, b, buffer, minGallop, less); };
+
+        for (int lo = 0; lo < size;)
+        {
+            int length = naturalRun(lo, less);
+            if (length < minRun)
+            {
+                int forced = std::min(minRun, size - lo);
+                for (int i = lo + length; i < lo + forced; ++i)
+                {
+                    Transaction *t = data[i];
+                    Transaction **slot = std::upper_bound(data + lo, data + i, t, less);
+                    std::copy_backward(slot, data + i, data + i + 1);
+                    *slot = t;
+                }
+                length = forced;
+            }
+            runs.push_back(ArrayRun{lo, length});
+            collapseRuns(runs, merge, false);
+            lo += length;
+        }
+        collapseRuns(runs, merge, true);
+    }
+
+    // Stable sort on the string text(transaction), see normalizedPrefixSort
+    template <typename Text>
+    void prefixKeySort(Text text)
+    {
+        state.reordered(ORDER_UNKNOWN);
+        std::vector<Transaction *> items(data, data + size);
+        normalizedPrefixSort(items, text);
+        std::copy(items.begin(), items.end(), data);
+    }
+
+    // Unstable in-place sort for any strict-weak-order comparator, see introSortRange
+    template <typename Less>
+    void introSort(Less less)
+    {
+        state.reordered(ORDER_UNKNOWN);
+        int badAllowed = 1;
+        for (int n = size; n > 1; n >>= 1)
+            ++badAllowed;
+        introSortRange(0, size, badAllowed, less);
+    }
+
+    // Original middle-pivot Hoare quicksort on location strings. sortByLocation
+    // now uses introSort; this is kept as the baseline for the sort benchmarks.
+    void quickSort(int left, int right)
+    {
+        state.reordered(ORDER_UNKNOWN);
+        if (left >= right)
+            return;
+
+        std::string pivot = store.value(data[(left + right) / 2], COL_LOCATION);
+        int i = left;
+        int j = right;
+
+        while (i <= j)
+        {
+            while (store.value(data[i], COL_LOCATION) < pivot)
+                i++;
+            while (store.value(data[j], COL_LOCATION) > pivot)
+                j--;
+
+            if (i <= j)
+            {
+                std::swap(data[i], data[j]);
+                i++;
+                j--;
+            }
+        }
+
+        if (left < j)
+            quickSort(left, j);
+        if (i < right)
+            quickSort(i, right);
+    }
+
+    // Parallel stable merge sort for any strict-weak-order comparator. The array
+    // is cut into one chunk per thread and each chunk stable-sorted; adjacent
+    // runs are then merged pairwise in rounds, each merge split between the
+    // idle threads by a merge-path search. Chunking and merge splits depend
+    // only on the data and threadCount, and every step is stable, so the
+    // result is identical to std::stable_sort(data, data + size, less).
+    template <typename Less>
+    void parallelSort(Less less, unsigned threadCount)
+    {
+        state.reordered(ORDER_UNKNOWN);
+        size_t chunks = std::max<size_t>(1, std::min<size_t>(threadCount, size / PARALLEL_SORT_MIN_CHUNK));
+        if (chunks == 1)
+        {
+            std::stable_sort(data, data + size, less);
+            return;
+        }
+
+        std::vector<int> bounds(chunks + 1);
+        for (size_t k = 0; k <= chunks; ++k)
+            bounds[k] = static_cast<int>(static_cast<size_t>(size) * k / chunks);
+
+        std::vector<std::thread> workers;
+        for (size_t k = 0; k < chunks; ++k)
+            workers.emplace_back([this, &bounds, less, k]
+                                 { std::stable_sort(data + bounds[k], data + bounds[k + 1], less); });
+        for (std::thread &worker : workers)
+            worker.join();
+
+        std::vector<Transaction *> scratch(size);
+        Transaction **from = data;
+        Transaction **to = scratch.data();
+        for (size_t width = 1; width < chunks; width *= 2)
+        {
+            size_t pairs = (chunks + 2 * width - 1) / (2 * width);
+            size_t parts = std::max<size_t>(1, chunks / pairs);
+            workers.clear();
+            for (size_t k = 0; k < chunks; k += 2 * width)
+            {
+                int lo = bounds[k];
+                int mid = bounds[std::min(k + width, chunks)];
+                int hi = bounds[std::min(k + 2 * width, chunks)];
+                for (size_t p = 0; p < parts; ++p)
+                {
+                    int outBegin = lo + static_cast<int>(static_cast<size_t>(hi - lo) * p / parts);
+                    int outEnd = lo + static_cast<int>(static_cast<size_t>(hi - lo) * (p + 1) / parts);
+                    workers.emplace_back([=]
+                                         {
+                        int i = mergePathSplit(from + lo, mid - lo, from + mid, hi - mid, outBegin - lo, less);
+                        int iEnd = mergePathSplit(from + lo, mid - lo, from + mid, hi - mid, outEnd - lo, less);
+                        std::merge(from + lo + i, from + lo + iEnd,
+                                   from + mid + (outBegin - lo - i), from + mid + (outEnd - lo - iEnd),
+                                   to + outBegin, less); });
+                }
+            }
+            for (std::thread &worker : workers)
+                worker.join();
+            std::swap(from, to);
+        }
+
+        if (from != data)
+            std::copy(from, from + size, data);
+    }
+
+    void print(int limit = 20) const
+    {
+        std::cout << "[INFO] Showing first " << limit << " sorted transactions:\n";
+        for (int i = 0; i < size && i < limit; ++i)
+        {
+            const TransactionDetails &d = store.detailsOf(data[i]);
+            std::cout << d.transaction_id << " | "
+                      << store.value(data[i], COL_TRANSACTION_TYPE) << " | "
+                      << d.timestamp << " | "
+                      << d.sender_account << " | "
+                      << d.receiver_account << " | "
+                      << store.amount(data[i]) << " | "
+                      << store.value(data[i], COL_PAYMENT_CHANNEL) << " | "
+                      << store.value(data[i], COL_LOCATION) << "\n";
+        }
+    }
+
+    // Stable LSD radix sort on the dictionary rank of `column`, 8 bits per pass,
+    // ping-ponging between the pointer array and one scratch array. Passes above
+    // the highest rank's top byte are skipped, so small domains take one pass.
+    void radixSortBy(CategoricalColumn column, bool ignoreCase = false)
+    {
+        state.reordered(orderOf(column, ignoreCase));
+        if (size < 2)
+            return;
+
+        std::vector<uint32_t> rank = store.dictionary(column).sortedRanks(ignoreCase);
+        uint32_t maxRank = rank.empty() ? 0 : *std::max_element(rank.begin(), rank.end());
+        std::vector<Transaction *> scratch(size);
+        Transaction **from = data;
+        Transaction **to = scratch.data();
+
+        for (int shift = 0; shift == 0 || (shift < 32 && (maxRank >> shift) != 0); shift += 8)
+        {
+            int count[257] = {};
+            for (int i = 0; i < size; ++i)
+                ++count[((rank[from[i]->codes[column]] >> shift) & 0xFF) + 1];
+            for (int digit = 0; digit < 256; ++digit)
+                count[digit + 1] += count[digit];
+            for (int i = 0; i < size; ++i)
+                to[count[(rank[from[i]->codes[column]] >> shift) & 0xFF]++] = from[i];
+            std::swap(from, to);
+        }
+
+        if (from != data)
+            std::copy(from, from + size, data);
+    }
+
+    // Sort on a list of SortKey types, see MultiKeyLess. The comparator is
+    // built once and passed by reference, so its rank tables are never copied.
+    // Row id breaks any remaining tie, so introSort on one thread and
+    // parallelSort on several produce the same order.
+    template <typename... Keys>
+    void sortBy(unsigned threadCount = 1)
+    {
+        MultiKeyLess<Keys..., SortKey<RowIdField>> keys(store);
+        auto less = [&keys](const Transaction *a, const Transaction *b)
+        { return keys(a, b); };
+        if (threadCount > 1)
+            parallelSort(less, threadCount);
+        else
+            introSort(less);
+    }
+
+    void sortByTransactionType(TypeSortMode mode = TYPE_SORT_PRECOMPUTED_KEY)
+    {
+        state.reordered(ORDER_BY_TYPE);
+        if (mode == TYPE_SORT_RADIX)
+        {
+            radixSortBy(COL_TRANSACTION_TYPE, true);
+            return;
+        }
+        if (mode == TYPE_SORT_FOLD_PER_COMPARE)
+        {
+            std::sort(data, data + size, [this](Transaction *a, Transaction *b)
+                      { return compareIgnoreCase(store.value(a, COL_TRANSACTION_TYPE), store.value(b, COL_TRANSACTION_TYPE)) < 0; });
+            return;
+        }
+
+        // Pack (folded rank, current position) into one integer per row, sort
+        // those, then apply the resulting permutation to the pointer array.
+        // The position in the low bits keeps equal types in their prior order.
+        std::vector<uint32_t> rank = store.dictionary(COL_TRANSACTION_TYPE).sortedRanks(true);
+        std::vector<uint64_t> keys(size);
+        for (int i = 0; i < size; ++i)
+            keys[i] = (static_cast<uint64_t>(rank[data[i]->codes[COL_TRANSACTION_TYPE]]) << 32) | static_cast<uint32_t>(i);
+        std::sort(keys.begin(), keys.end());
+
+        std::vector<Transaction *> sorted(size);
+        for (int i = 0; i < size; ++i)
+            sorted[i] = data[keys[i] & 0xFFFFFFFFu];
+        std::copy(sorted.begin(), sorted.end(), data);
+    }
+
+    void binarySearchTransactionType(const std::string &type) const
     {
         std::string searchType = toLower(type);
         int left = 0, right = size - 1;
@@ -437,20 +4189,18 @@ public:
         while (left <= right)
         {
             int mid = (left + right) / 2;
-            std::string midType = toLower(data[mid]->transaction_type);
+            const std::string &midType = store.foldedValue(data[mid], COL_TRANSACTION_TYPE);
 
             if (midType == searchType)
             {
                 // Search adjacent entries with the same type
                 int i = mid;
-                while (i >= 0 && toLower(data[i]->transaction_type) == searchType)
+                while (i >= 0 && store.foldedValue(data[i], COL_TRANSACTION_TYPE) == searchType)
                     --i;
                 ++i;
-                while (i < size && toLower(data[i]->transaction_type) == searchType)
+                while (i < size && store.foldedValue(data[i], COL_TRANSACTION_TYPE) == searchType)
                 {
-                    std::cout << data[i]->transaction_id << " | "
-                              << data[i]->transaction_type << " | "
-                              << data[i]->location << "\n";
+                    printSearchHit(store, data[i]);
                     ++i;
                     found = true;
                 }
@@ -466,388 +4216,1292 @@ public:
             std::cout << "[INFO] No transactions found for type: " << type << "\n";
     }
 
-    void benchmarkOperation() const
+    long long benchmarkOperation() const
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < size; ++i)
+        {
+            volatile double x = store.amount(data[i]) * 2.0;
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        long long elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        std::cout << "Traversal benchmark (Array): " << elapsed << " ns\n";
+        return elapsed;
+    }
+
+    // The comparison sort is introSort on the location ranks, with threadCount
+    // > 1 parallelSort instead; ties are broken by row id so both give the
+    // same order whatever the thread count
+    void sortByLocation(SortAlgorithm algorithm = SORT_COMPARISON, unsigned threadCount = 1)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        if (algorithm == SORT_RADIX)
+        {
+            radixSortBy(COL_LOCATION);
+        }
+        else if (algorithm == SORT_ADAPTIVE)
+        {
+            std::vector<uint32_t> rank = store.dictionary(COL_LOCATION).sortedRanks();
+            adaptiveSort([&rank](const Transaction *a, const Transaction *b)
+                         { return rank[a->codes[COL_LOCATION]] < rank[b->codes[COL_LOCATION]]; });
+        }
+        else if (algorithm == SORT_PREFIX_KEY)
+        {
+            prefixKeySort([this](const Transaction *t) -> const std::string &
+                          { return store.value(t, COL_LOCATION); });
+        }
+        else
+        {
+            std::vector<uint32_t> rank = store.dictionary(COL_LOCATION).sortedRanks();
+            auto byRank = [&rank](const Transaction *a, const Transaction *b)
+            {
+                uint32_t ra = rank[a->codes[COL_LOCATION]], rb = rank[b->codes[COL_LOCATION]];
+                return ra != rb ? ra < rb : a->row_id < b->row_id;
+            };
+            if (threadCount > 1)
+                parallelSort(byRank, threadCount);
+            else
+                introSort(byRank);
+        }
+        state.reordered(ORDER_BY_LOCATION);
+        auto end = std::chrono::high_resolution_clock::now();
+
+    }
+
+    // Equality lookups go through the store's hash index: one probe plus the
+    // matching rows, with no pass over the array
+    void searchTransactionType(const std::string &type) const
+    {
+        const std::vector<uint32_t> &rowIds = store.hashIndex(COL_TRANSACTION_TYPE).lookup(type);
+        std::cout << "Searching for transaction type: " << type << "\n";
+        for (uint32_t rowId : rowIds)
+            printSearchHit(store, store.row(rowId));
+        if (rowIds.empty())
+            std::cout << "[INFO] No transactions found for type: " << type << "\n";
+    }
+
+    // Scans the whole array, so the container comparison measures the array
+    // itself; the index lookup is timed separately by benchmarkIndexSearch
+    long long benchmarkSearch(const std::string &type) const
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<uint32_t> codes = store.dictionary(COL_TRANSACTION_TYPE).lookupIgnoreCase(type);
+
+        for (int i = 0; i < size; ++i)
+        {
+            if (std::find(codes.begin(), codes.end(), data[i]->codes[COL_TRANSACTION_TYPE]) != codes.end())
+            {
+                volatile auto tmp = store.amount(data[i]);
+            }
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    }
+};
+
+// The same type search as the containers' benchmarkSearch, answered by one
+// probe of the store's hash index plus a walk over the matching rows
+long long benchmarkIndexSearch(const TransactionStore &store, const std::string &type)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    volatile double sink = 0.0;
+    for (uint32_t rowId : store.hashIndex(COL_TRANSACTION_TYPE).lookup(type))
+        sink = sink + store.numbers().amount(rowId);
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+int loadCSV(TransactionStore &store, TransactionArray &array, TransactionList &fullList,
+             const std::string &filename)
+{
+    std::ifstream file(filename);
+    if (!file)
+    {
+        std::cerr << "[ERROR] Failed to open file: " << filename << "\n";
+        return false;
+    }
+
+    std::string line;
+    int lineNum = 0, totalLoaded = 0, totalSkipped = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    while (std::getline(file, line))
+    {
+        ++lineNum;
+        if (lineNum == 1)
+            continue;
+        if (lineNum % 100000 == 0)
+            std::cout << "[INFO] Processing line " << lineNum << "...\n";
+
+        std::stringstream ss(line);
+        std::string token;
+        TransactionDetails details;
+        std::string values[CATEGORICAL_COLUMN_COUNT];
+        TransactionMetrics metrics;
+
+        try
+        {
+            std::getline(ss, details.transaction_id, ',');
+            std::getline(ss, details.timestamp, ',');
+            if (!parseTimestamp(details.timestamp, metrics.timestamp))
+            {
+                ++totalSkipped;
+                continue;
+            }
+            std::getline(ss, details.sender_account, ',');
+            std::getline(ss, details.receiver_account, ',');
+            std::getline(ss, token, ',');
+            metrics.amount = token.empty() ? 0.0 : std::stod(token);
+            std::getline(ss, values[COL_TRANSACTION_TYPE], ',');
+            std::getline(ss, values[COL_MERCHANT_CATEGORY], ',');
+            std::getline(ss, values[COL_LOCATION], ',');
+            std::getline(ss, values[COL_DEVICE_USED], ',');
+            std::getline(ss, token, ',');
+            metrics.is_fraud = (token == "1" || token == "true" || token == "True");
+            std::getline(ss, values[COL_FRAUD_TYPE], ',');
+            std::getline(ss, token, ',');
+            metrics.scores[SCORE_TIME_SINCE_LAST] = token.empty() ? 0.0 : std::stod(token);
+            std::getline(ss, token, ',');
+            metrics.scores[SCORE_SPENDING_DEVIATION] = token.empty() ? 0.0 : std::stod(token);
+            std::getline(ss, token, ',');
+            metrics.scores[SCORE_VELOCITY] = token.empty() ? 0.0 : std::stod(token);
+            std::getline(ss, token, ',');
+            metrics.scores[SCORE_GEO_ANOMALY] = token.empty() ? 0.0 : std::stod(token);
+            std::getline(ss, values[COL_PAYMENT_CHANNEL], ',');
+            std::getline(ss, details.ip_address, ',');
+            std::getline(ss, details.device_hash, ',');
+
+            if (totalLoaded < MAX_TRANSACTIONS)
+            {
+                Transaction *t = store.add(std::move(details), values, metrics);
+                array.insert(t);
+                fullList.append(t);
+            }
+
+            ++totalLoaded;
+            if (totalLoaded >= MAX_TOTAL_RECORDS)
+                break;
+        }
+        catch (...)
+        {
+            ++totalSkipped;
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "[DONE] CSV load complete. Loaded: " << totalLoaded
+              << ", Skipped: " << totalSkipped
+              << ", Time: " << std::chrono::duration_cast<std::chrono::seconds>(end - start).count()
+              << " seconds.\n";
+
+    const NumericColumns &numbers = store.numbers();
+    size_t exactBytes = NumericColumns::exactBytes(numbers.size());
+    size_t usedBytes = numbers.bytesUsed();
+    std::cout << "[INFO] Numeric storage (" << (numbers.getMode() == STORAGE_COMPACT ? "compact" : "exact")
+              << "): " << usedBytes / 1024.0 << " KB";
+    if (numbers.getMode() == STORAGE_COMPACT && exactBytes > 0)
+        std::cout << ", saved " << (exactBytes - usedBytes) / 1024.0 << " KB ("
+                  << std::fixed << std::setprecision(1) << 100.0 * (exactBytes - usedBytes) / exactBytes
+                  << std::defaultfloat << std::setprecision(6) << "%) vs exact";
+    std::cout << "\n";
+    return true;
+}
+
+void showMenu()
+{
+    std::cout << "\n=== Transaction Manager ===\n";
+    std::cout << "1. Partition by column (payment channel, type, ...)\n";
+    std::cout << "2. Run Benchmark\n";
+    std::cout << "3. Sort Array by Location\n";
+    std::cout << "4. Sort Linked List by Location\n";
+    std::cout << "5. Search Transaction Type (Array)\n";
+    std::cout << "6. Search Transaction Type (List)\n";
+    std::cout << "7. Compare Performance (Array vs Linked List)\n";
+    std::cout << "8. Export to JSON\n";
+    std::cout << "9. Range / equality query (zone-map scan)\n";
+    std::cout << "10. Linked list sort benchmark (growing sizes)\n";
+    std::cout << "11. Transaction type sort benchmark (fold per compare / precomputed key / radix)\n";
+    std::cout << "12. Location sort benchmark (comparison vs radix)\n";
+    std::cout << "13. Parallel array sort benchmark\n";
+    std::cout << "14. Array sort benchmark (quickSort vs introsort)\n";
+    std::cout << "15. Sort by location, amount (desc), timestamp\n";
+    std::cout << "16. External sort of a CSV file\n";
+    std::cout << "17. Top-K by numeric column\n";
+    std::cout << "18. Adaptive sort benchmark (varying presortedness)\n";
+    std::cout << "19. String sort benchmark (string compare vs prefix key)\n";
+    std::cout << "20. Query (=, IN, <, BETWEEN, PREFIX with AND / OR / NOT)\n";
+    std::cout << "21. Range query on amount / timestamp / time of day (ordered index)\n";
+    std::cout << "22. Account history (sent and received)\n";
+    std::cout << "23. Look up transactions by ID\n";
+    std::cout << "0. Exit\n";
+    std::cout << "Enter choice: ";
+}
+
+json transactionToJSON(const TransactionStore &store, const Transaction *t)
+{
+    const NumericColumns &numbers = store.numbers();
+    const TransactionDetails &d = store.detailsOf(t);
+    json jt;
+    jt["transaction_id"] = d.transaction_id;
+    jt["timestamp"] = d.timestamp;
+    jt["sender_account"] = d.sender_account;
+    jt["receiver_account"] = d.receiver_account;
+    jt["amount"] = numbers.amount(t->row_id);
+    jt["transaction_type"] = store.value(t, COL_TRANSACTION_TYPE);
+    jt["merchant_category"] = store.value(t, COL_MERCHANT_CATEGORY);
+    jt["location"] = store.value(t, COL_LOCATION);
+    jt["device_used"] = store.value(t, COL_DEVICE_USED);
+    jt["is_fraud"] = numbers.isFraud(t->row_id);
+    jt["fraud_type"] = store.value(t, COL_FRAUD_TYPE);
+    for (int c = 0; c < SCORE_COLUMN_COUNT; ++c)
+    {
+        ScoreColumn column = static_cast<ScoreColumn>(c);
+        jt[scoreColumnName(column)] = numbers.displayScore(column, t->row_id);
+    }
+    jt["payment_channel"] = store.value(t, COL_PAYMENT_CHANNEL);
+    jt["ip_address"] = d.ip_address;
+    jt["device_hash"] = d.device_hash;
+    return jt;
+}
+
+// Tells the user when a search or export got its order without a full sort
+void reportSortReuse(const char *container, SortReuse reuse, const SortState &state)
+{
+    if (reuse == SORT_REUSED)
+        std::cout << "[INFO] " << container << " already in the requested order (version "
+                  << state.version << "), no re-sort needed.\n";
+    else if (reuse == SORT_MERGED_APPENDED)
+        std::cout << "[INFO] " << container << ": merged the rows appended since the last sort.\n";
+}
+
+// Resolves comma or space separated transaction ids through the store's id
+// index, in the order given; ids no row has are reported and skipped
+std::vector<uint32_t> lookupTransactionIds(const TransactionStore &store, const std::string &ids)
+{
+    std::vector<uint32_t> rowIds;
+    std::string text = ids;
+    std::replace(text.begin(), text.end(), ',', ' ');
+    std::istringstream in(text);
+    std::string id;
+    while (in >> id)
+    {
+        if (const Transaction *t = store.findById(id))
+            rowIds.push_back(t->row_id);
+        else
+            std::cout << "[INFO] No transaction with id: " << id << "\n";
+    }
+    return rowIds;
+}
+
+void exportCustomJSON(const TransactionStore &store, TransactionArray &array, TransactionList &list,
+                      SortedIndexCache &sortedIndexes)
+{
+    int choice;
+    std::cout << "\nChoose export type:\n";
+    std::cout << "1. Full dataset (Array)\n";
+    std::cout << "2. Sorted by Location (Array)\n";
+    std::cout << "3. Sorted by Location (Linked List)\n";
+    std::cout << "4. Search by Transaction Type (Array)\n";
+    std::cout << "5. Search by Transaction Type (Linked List)\n";
+    std::cout << "6. Transactions by ID\n";
+    std::cout << "Enter choice: ";
+    std::cin >> choice;
+    std::cin.ignore();
+
+    std::string filename;
+    std::cout << "Enter filename: ";
+    std::getline(std::cin, filename);
+    if (filename.size() < 5 || filename.substr(filename.size() - 5) != ".json")
+        filename += ".json";
+
+    json jArray = json::array();
+
+    if (choice == 1)
+    {
+        for (int i = 0; i < array.getSize(); ++i)
+        {
+            Transaction *t = array.getData()[i];
+            jArray.push_back(transactionToJSON(store, t));
+        }
+    }
+    else if (choice == 2)
+    {
+        reportSortReuse("Array", array.ensureSortedBy(ORDER_BY_LOCATION, &sortedIndexes), array.sortState());
+        for (int i = 0; i < array.getSize(); ++i)
+        {
+            Transaction *t = array.getData()[i];
+            jArray.push_back(transactionToJSON(store, t));
+        }
+    }
+    else if (choice == 3)
+    {
+        reportSortReuse("Linked list", list.ensureSortedBy(ORDER_BY_LOCATION, &sortedIndexes), list.sortState());
+        Node *curr = list.getHead();
+        while (curr)
+        {
+            Transaction *t = curr->data;
+            jArray.push_back(transactionToJSON(store, t));
+            curr = curr->next;
+        }
+    }
+    else if (choice == 4)
+    {
+        std::string type;
+        std::cout << "Enter transaction type to search (array): ";
+        std::getline(std::cin, type);
+        reportSortReuse("Array", array.ensureSortedBy(ORDER_BY_TYPE, &sortedIndexes), array.sortState());
+
+        for (int i = 0; i < array.getSize(); ++i)
+        {
+            if (equalsIgnoreCase(store.value(array.getData()[i], COL_TRANSACTION_TYPE), type))
+            {
+                Transaction *t = array.getData()[i];
+                jArray.push_back(transactionToJSON(store, t));
+            }
+        }
+    }
+    else if (choice == 5)
+    {
+        std::string type;
+        std::cout << "Enter transaction type to search (linked list): ";
+        std::getline(std::cin, type);
+        reportSortReuse("Linked list", list.ensureSortedBy(ORDER_BY_TYPE, &sortedIndexes), list.sortState());
+
+        Node *curr = list.getHead();
+        while (curr)
+        {
+            if (equalsIgnoreCase(store.value(curr->data, COL_TRANSACTION_TYPE), type))
+            {
+                Transaction *t = curr->data;
+                jArray.push_back(transactionToJSON(store, t));
+            }
+            curr = curr->next;
+        }
+    }
+    else if (choice == 6)
+    {
+        std::string ids;
+        std::cout << "Enter transaction ids (comma or space separated): ";
+        std::getline(std::cin, ids);
+        for (uint32_t rowId : lookupTransactionIds(store, ids))
+            jArray.push_back(transactionToJSON(store, store.row(rowId)));
+    }
+    else
+    {
+        std::cout << "[ERROR] Invalid export type.\n";
+        return;
+    }
+
+    std::ofstream out(filename);
+    if (!out)
+    {
+        std::cerr << "[ERROR] Failed to write to JSON file.\n";
+        return;
+    }
+    out << std::setw(4) << jArray << std::endl;
+    std::cout << "[SUCCESS] Exported to " << filename << "\n";
+}
+
+// External merge sort of a CSV file that need not fit in memory. Phase 1
+// reads rows until the memory budget is used up, sorts them and spills each
+// such run to a temp file; phase 2 k-way merges all runs through a loser tree
+// into the output. Runs and binary output share one record format:
+//   numeric key: f64 key,              u32 line length, line bytes
+//   text key:    u32 key length, key,  u32 line length, line bytes
+// Runs are cut in input order and ties go to the earlier run, so the sort is
+// stable.
+enum ExternalOutputFormat
+{
+    EXTERNAL_OUTPUT_CSV,
+    EXTERNAL_OUTPUT_JSON,
+    EXTERNAL_OUTPUT_BINARY
+};
+
+struct ExternalSortOptions
+{
+    std::string inputFile;
+    std::string outputFile;
+    std::string keyColumn = "location";
+    bool descending = false;
+    size_t memoryBudget = 4 * 1024 * 1024; // bytes of rows held per run
+    ExternalOutputFormat format = EXTERNAL_OUTPUT_CSV;
+};
+
+struct ExternalSortStats
+{
+    size_t rowsSorted = 0;
+    size_t rowsSkipped = 0;
+    size_t runs = 0;
+    size_t runBytesRead = 0;     // phase 1: CSV input
+    size_t runBytesWritten = 0;  // phase 1: spilled runs
+    long long runMicros = 0;
+    size_t mergePasses = 0;      // phase 2: intermediate passes + the final merge
+    size_t mergeBytesRead = 0;   // phase 2: runs read back
+    size_t mergeBytesWritten = 0; // phase 2: intermediate runs and final output
+    long long mergeMicros = 0;
+};
+
+struct ExternalRecord
+{
+    double number = 0.0;
+    std::string text;
+    std::string line;
+};
+
+struct ExternalKeyLess
+{
+    bool numeric;
+    bool descending;
+
+    bool operator()(const ExternalRecord &a, const ExternalRecord &b) const
+    {
+        if (numeric)
+            return descending ? b.number < a.number : a.number < b.number;
+        return descending ? b.text < a.text : a.text < b.text;
+    }
+};
+
+class ExternalRunWriter
+{
+private:
+    std::ofstream out;
+    bool numeric;
+
+    void writeU32(uint32_t value) { out.write(reinterpret_cast<const char *>(&value), sizeof(value)); }
+
+public:
+    size_t bytesWritten = 0;
+
+    ExternalRunWriter(const std::string &path, bool numeric) : out(path, std::ios::binary), numeric(numeric) {}
+    bool ok() const { return static_cast<bool>(out); }
+
+    void write(const ExternalRecord &r)
     {
-        auto start = std::chrono::high_resolution_clock::now();
-        for (int i = 0; i < size; ++i)
+        if (numeric)
         {
-            volatile double x = data[i]->amount * 2.0;
+            out.write(reinterpret_cast<const char *>(&r.number), sizeof(r.number));
+            bytesWritten += sizeof(r.number);
         }
-        auto end = std::chrono::high_resolution_clock::now();
-        std::cout << "Traversal benchmark (Array): "
-                  << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()
-                  << " ns\n";
+        else
+        {
+            writeU32(static_cast<uint32_t>(r.text.size()));
+            out.write(r.text.data(), r.text.size());
+            bytesWritten += sizeof(uint32_t) + r.text.size();
+        }
+        writeU32(static_cast<uint32_t>(r.line.size()));
+        out.write(r.line.data(), r.line.size());
+        bytesWritten += sizeof(uint32_t) + r.line.size();
     }
+};
 
-    void sortByLocation()
+class ExternalRunReader
+{
+private:
+    std::ifstream in;
+    bool numeric;
+
+    bool readString(std::string &s)
     {
-        auto start = std::chrono::high_resolution_clock::now();
-        quickSort(0, size - 1);
-        auto end = std::chrono::high_resolution_clock::now();
+        uint32_t length;
+        if (!in.read(reinterpret_cast<char *>(&length), sizeof(length)))
+            return false;
+        s.resize(length);
+        in.read(&s[0], length);
+        bytesRead += sizeof(length) + length;
+        return static_cast<bool>(in);
+    }
+
+public:
+    size_t bytesRead = 0;
 
+    ExternalRunReader(const std::string &path, bool numeric) : in(path, std::ios::binary), numeric(numeric) {}
+    bool ok() const { return in.is_open(); }
+
+    bool next(ExternalRecord &r)
+    {
+        if (numeric)
+        {
+            if (!in.read(reinterpret_cast<char *>(&r.number), sizeof(r.number)))
+                return false;
+            bytesRead += sizeof(r.number);
+        }
+        else if (!readString(r.text))
+            return false;
+        return readString(r.line);
     }
+};
 
-    void searchTransactionType(const std::string &type) const
+// Tournament tree of losers over k runs: the root holds the overall winner,
+// every internal node the loser of the match played there. Taking the winner
+// and refilling its leaf replays only the leaf-to-root path, so each output
+// row costs log2(k) comparisons. Leaves sit at k..2k-1 of the implicit tree.
+class LoserTree
+{
+private:
+    std::vector<ExternalRunReader> &runs;
+    ExternalKeyLess less;
+    std::vector<ExternalRecord> current;
+    std::vector<bool> live;
+    std::vector<int> tree; // at least one slot so tree[0] exists with zero runs
+    int k;
+
+    // True if run a's head goes out before run b's; exhausted runs always lose
+    // and equal keys go to the earlier run
+    bool beats(int a, int b) const
     {
-        std::string searchType = toLower(type);
-        std::cout << "Searching for transaction type: " << type << "\n";
+        if (!live[b])
+            return true;
+        if (!live[a])
+            return false;
+        if (less(current[a], current[b]))
+            return true;
+        if (less(current[b], current[a]))
+            return false;
+        return a < b;
+    }
 
-        bool found = false;
-        for (int i = 0; i < size; ++i)
+    int build(int node)
+    {
+        if (node >= k)
+            return node - k;
+        int a = build(2 * node);
+        int b = build(2 * node + 1);
+        if (beats(a, b))
         {
-            if (toLower(data[i]->transaction_type) == searchType)
-            {
-                std::cout << data[i]->transaction_id << " | "
-                          << data[i]->transaction_type << " | "
-                          << data[i]->location << "\n";
-                found = true;
-            }
+            tree[node] = b;
+            return a;
         }
+        tree[node] = a;
+        return b;
+    }
 
-        if (!found)
+public:
+    LoserTree(std::vector<ExternalRunReader> &runs, ExternalKeyLess less)
+        : runs(runs), less(less), current(runs.size()), live(runs.size()), tree(std::max<size_t>(runs.size(), 1)),
+          k(static_cast<int>(runs.size()))
+    {
+        for (int i = 0; i < k; ++i)
+            live[i] = runs[i].next(current[i]);
+        tree[0] = k > 1 ? build(1) : 0;
+    }
+
+    bool empty() const { return k == 0 || !live[tree[0]]; }
+    const ExternalRecord &top() const { return current[tree[0]]; }
+
+    void pop()
+    {
+        int winner = tree[0];
+        live[winner] = runs[winner].next(current[winner]);
+        for (int node = (winner + k) / 2; node > 0; node /= 2)
         {
-            std::cout << "[INFO] No transactions found with payment channel: " << type << "\n";
+            if (beats(tree[node], winner))
+                std::swap(tree[node], winner);
         }
+        tree[0] = winner;
     }
+};
 
-    long long benchmarkSearch(const std::string &type) const
-    {
-        std::string searchType = toLower(type);
-        auto start = std::chrono::high_resolution_clock::now();
+bool isScoreColumnName(const std::string &name)
+{
+    ScoreColumn column;
+    return parseScoreColumn(name, column);
+}
 
-        for (int i = 0; i < size; ++i)
+// One CSV row as a JSON object, typed like transactionToJSON. Rows are only
+// validated on the sort key, so a numeric field that does not parse becomes null
+json csvFieldsToJSON(const std::vector<std::string> &header, const std::vector<std::string> &fields)
+{
+    json jt;
+    for (size_t i = 0; i < header.size(); ++i)
+    {
+        const std::string value = i < fields.size() ? fields[i] : std::string();
+        if (header[i] == "amount" || isScoreColumnName(header[i]))
         {
-            if (toLower(data[i]->transaction_type) == searchType)
+            try
+            {
+                jt[header[i]] = value.empty() ? 0.0 : std::stod(value);
+            }
+            catch (...)
             {
-                volatile auto tmp = data[i]->amount;
+                jt[header[i]] = nullptr;
             }
         }
-
-        auto end = std::chrono::high_resolution_clock::now();
-        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        else if (header[i] == "is_fraud")
+            jt[header[i]] = (value == "1" || value == "true" || value == "True");
+        else
+            jt[header[i]] = value;
     }
-};
+    return jt;
+}
 
-int loadCSV(TransactionArray &array, TransactionList &fullList,
-             TransactionList &cardList, TransactionList &achList,
-             TransactionList &upiList, TransactionList &wireList,
-             const std::string &filename)
+std::vector<std::string> splitCSVLine(const std::string &line)
 {
-    std::ifstream file(filename);
-    if (!file)
+    std::vector<std::string> fields;
+    std::stringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, ','))
+        fields.push_back(field);
+    if (!line.empty() && line.back() == ',')
+        fields.emplace_back();
+    return fields;
+}
+
+bool externalSort(const ExternalSortOptions &options, ExternalSortStats &stats)
+{
+    std::ifstream input(options.inputFile);
+    if (!input)
     {
-        std::cerr << "[ERROR] Failed to open file: " << filename << "\n";
+        std::cerr << "[ERROR] Failed to open file: " << options.inputFile << "\n";
         return false;
     }
 
-    std::string line;
-    int lineNum = 0, totalLoaded = 0, totalSkipped = 0;
-    auto start = std::chrono::high_resolution_clock::now();
+    std::string headerLine;
+    std::getline(input, headerLine);
+    stats.runBytesRead += headerLine.size() + 1;
+    if (!headerLine.empty() && headerLine.back() == '\r')
+        headerLine.pop_back();
+    std::vector<std::string> header = splitCSVLine(headerLine);
+    auto keyIt = std::find(header.begin(), header.end(), options.keyColumn);
+    if (keyIt == header.end())
+    {
+        std::cerr << "[ERROR] Unknown column: " << options.keyColumn << "\n";
+        return false;
+    }
+    size_t keyIndex = keyIt - header.begin();
+    bool isTimestamp = options.keyColumn == "timestamp";
+    bool numeric = isTimestamp || options.keyColumn == "amount" || isScoreColumnName(options.keyColumn);
+    ExternalKeyLess less{numeric, options.descending};
+
+    // Phase 1: sorted runs bounded by the memory budget
+    std::vector<std::string> runFiles;
+    auto phaseStart = std::chrono::high_resolution_clock::now();
+    std::string runTag = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    std::vector<ExternalRecord> buffer;
+    size_t bufferBytes = 0;
+    bool failed = false;
+    size_t runsCreated = 0;
+    auto runPath = [&]()
+    {
+        return (std::filesystem::temp_directory_path() /
+                ("transactions_run_" + runTag + "_" + std::to_string(runsCreated++) + ".bin"))
+            .string();
+    };
 
-    while (std::getline(file, line))
+    auto spill = [&]()
     {
-        ++lineNum;
-        if (lineNum == 1)
-            continue;
-        if (lineNum % 100000 == 0)
-            std::cout << "[INFO] Processing line " << lineNum << "...\n";
+        if (buffer.empty())
+            return;
+        std::stable_sort(buffer.begin(), buffer.end(), less);
+        std::string path = runPath();
+        ExternalRunWriter writer(path, numeric);
+        if (!writer.ok())
+        {
+            std::cerr << "[ERROR] Failed to create run file: " << path << "\n";
+            failed = true;
+            return;
+        }
+        for (const ExternalRecord &r : buffer)
+            writer.write(r);
+        stats.runBytesWritten += writer.bytesWritten;
+        runFiles.push_back(path);
+        buffer.clear();
+        bufferBytes = 0;
+    };
 
-        std::stringstream ss(line);
-        std::string token;
-        Transaction *t = new Transaction();
+    std::string line;
+    while (!failed && std::getline(input, line))
+    {
+        stats.runBytesRead += line.size() + 1;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty())
+            continue;
 
-        try
+        std::vector<std::string> fields = splitCSVLine(line);
+        ExternalRecord record;
+        std::string key = keyIndex < fields.size() ? fields[keyIndex] : std::string();
+        if (isTimestamp)
         {
-            std::getline(ss, t->transaction_id, ',');
-            std::getline(ss, t->timestamp, ',');
-            std::getline(ss, t->sender_account, ',');
-            std::getline(ss, t->receiver_account, ',');
-            std::getline(ss, token, ',');
-            t->amount = token.empty() ? 0.0 : std::stod(token);
-            std::getline(ss, t->transaction_type, ',');
-            std::getline(ss, t->merchant_category, ',');
-            std::getline(ss, t->location, ',');
-            std::getline(ss, t->device_used, ',');
-            std::getline(ss, token, ',');
-            t->is_fraud = (token == "1" || token == "true" || token == "True");
-            std::getline(ss, t->fraud_type, ',');
-            std::getline(ss, token, ',');
-            t->time_since_last_transaction = token.empty() ? 0.0 : std::stod(token);
-            std::getline(ss, token, ',');
-            t->spending_deviation_score = token.empty() ? 0.0 : std::stod(token);
-            std::getline(ss, token, ',');
-            t->velocity_score = token.empty() ? 0.0 : std::stod(token);
-            std::getline(ss, token, ',');
-            t->geo_anomaly_score = token.empty() ? 0.0 : std::stod(token);
-            std::getline(ss, t->payment_channel, ',');
-            std::getline(ss, t->ip_address, ',');
-            std::getline(ss, t->device_hash, ',');
-
-            if (totalLoaded < MAX_TRANSACTIONS)
+            int64_t micros;
+            if (!parseTimestamp(key, micros))
             {
-                array.insert(t);
-                fullList.append(t);
+                ++stats.rowsSkipped;
+                continue;
+            }
+            record.number = static_cast<double>(micros);
+        }
+        else if (numeric)
+        {
+            try
+            {
+                record.number = key.empty() ? 0.0 : std::stod(key);
+            }
+            catch (...)
+            {
+                ++stats.rowsSkipped;
+                continue;
+            }
+        }
+        else
+            record.text = std::move(key);
+        record.line = std::move(line);
+
+        size_t recordBytes = sizeof(ExternalRecord) + stringHeapBytes(record.text) + stringHeapBytes(record.line);
+        if (!buffer.empty() && bufferBytes + recordBytes > options.memoryBudget)
+            spill();
+        buffer.push_back(std::move(record));
+        bufferBytes += recordBytes;
+        ++stats.rowsSorted;
+    }
+    if (!failed)
+        spill();
+    buffer.shrink_to_fit();
+    stats.runs = runFiles.size();
+    auto phaseEnd = std::chrono::high_resolution_clock::now();
+    stats.runMicros = std::chrono::duration_cast<std::chrono::microseconds>(phaseEnd - phaseStart).count();
+
+    // Phase 2: k-way merge into the output. With more runs than
+    // EXTERNAL_MERGE_FAN_IN, consecutive groups are first merged into longer
+    // runs, pass after pass, so no merge holds more files open than that;
+    // merging consecutive runs keeps equal keys in input order.
+    phaseStart = std::chrono::high_resolution_clock::now();
+    auto openRuns = [&](size_t first, size_t last, std::vector<ExternalRunReader> &runs)
+    {
+        runs.reserve(last - first);
+        for (size_t i = first; i < last; ++i)
+        {
+            runs.emplace_back(runFiles[i], numeric);
+            if (!runs.back().ok())
+            {
+                std::cerr << "[ERROR] Failed to open run file: " << runFiles[i] << "\n";
+                return false;
+            }
+        }
+        return true;
+    };
 
-                std::string ch = t->payment_channel;
-                if (ch == "card")
-                    cardList.append(t);
-                else if (ch == "ACH")
-                    achList.append(t);
-                else if (ch == "UPI")
-                    upiList.append(t);
-                else if (ch == "wire_transfer")
-                    wireList.append(t);
+    while (!failed && runFiles.size() > EXTERNAL_MERGE_FAN_IN)
+    {
+        std::vector<std::string> merged;
+        for (size_t first = 0; !failed && first < runFiles.size(); first += EXTERNAL_MERGE_FAN_IN)
+        {
+            std::string path = runPath();
+            ExternalRunWriter writer(path, numeric);
+            if (!writer.ok())
+            {
+                std::cerr << "[ERROR] Failed to create run file: " << path << "\n";
+                failed = true;
+                break;
             }
+            merged.push_back(path);
 
-            ++totalLoaded;
-            if (totalLoaded >= MAX_TOTAL_RECORDS)
+            std::vector<ExternalRunReader> runs;
+            if (!openRuns(first, std::min(first + EXTERNAL_MERGE_FAN_IN, runFiles.size()), runs))
+            {
+                failed = true;
                 break;
+            }
+            for (LoserTree tree(runs, less); !tree.empty(); tree.pop())
+                writer.write(tree.top());
+            if (!writer.ok())
+            {
+                std::cerr << "[ERROR] Failed to write run file: " << path << "\n";
+                failed = true;
+            }
+            stats.mergeBytesWritten += writer.bytesWritten;
+            for (const ExternalRunReader &run : runs)
+                stats.mergeBytesRead += run.bytesRead;
         }
-        catch (...)
+        ++stats.mergePasses;
+        for (const std::string &path : runFiles)
+            std::remove(path.c_str());
+        runFiles.swap(merged);
+    }
+
+    std::vector<ExternalRunReader> runs;
+    if (!failed)
+        failed = !openRuns(0, runFiles.size(), runs);
+
+    std::ofstream out;
+    if (!failed)
+    {
+        out.open(options.outputFile, options.format == EXTERNAL_OUTPUT_BINARY ? std::ios::binary : std::ios::out);
+        if (!out)
         {
-            delete t;
-            ++totalSkipped;
+            std::cerr << "[ERROR] Failed to write to file: " << options.outputFile << "\n";
+            failed = true;
         }
     }
 
-    auto end = std::chrono::high_resolution_clock::now();
-    std::cout << "[DONE] CSV load complete. Loaded: " << totalLoaded
-              << ", Skipped: " << totalSkipped
-              << ", Time: " << std::chrono::duration_cast<std::chrono::seconds>(end - start).count()
-              << " seconds.\n";
-    return true;
+    if (!failed)
+    {
+        LoserTree tree(runs, less);
+        ++stats.mergePasses;
+
+        if (options.format == EXTERNAL_OUTPUT_BINARY)
+        {
+            out.close();
+            ExternalRunWriter writer(options.outputFile, numeric);
+            for (; !tree.empty(); tree.pop())
+                writer.write(tree.top());
+            stats.mergeBytesWritten += writer.bytesWritten;
+        }
+        else if (options.format == EXTERNAL_OUTPUT_JSON)
+        {
+            // Streamed one object at a time, so the output never sits in memory
+            out << "[";
+            bool first = true;
+            for (; !tree.empty(); tree.pop())
+            {
+                out << (first ? "\n" : ",\n") << std::setw(4) << csvFieldsToJSON(header, splitCSVLine(tree.top().line));
+                first = false;
+            }
+            out << "\n]\n";
+            stats.mergeBytesWritten += static_cast<size_t>(out.tellp());
+        }
+        else
+        {
+            out << headerLine << "\n";
+            for (; !tree.empty(); tree.pop())
+                out << tree.top().line << "\n";
+            stats.mergeBytesWritten += static_cast<size_t>(out.tellp());
+        }
+
+        for (const ExternalRunReader &run : runs)
+            stats.mergeBytesRead += run.bytesRead;
+    }
+
+    runs.clear(); // close the runs before removing them
+    for (const std::string &path : runFiles)
+        std::remove(path.c_str());
+    phaseEnd = std::chrono::high_resolution_clock::now();
+    stats.mergeMicros = std::chrono::duration_cast<std::chrono::microseconds>(phaseEnd - phaseStart).count();
+    return !failed;
 }
 
-void showMenu()
+void runExternalSort(const std::string &loadedFile)
 {
-    std::cout << "\n=== Transaction Manager ===\n";
-    std::cout << "1. Payment channel sort\n";
-    std::cout << "2. Run Benchmark\n";
-    std::cout << "3. Sort Array by Location\n";
-    std::cout << "4. Sort Linked List by Location\n";
-    std::cout << "5. Search Transaction Type (Array)\n";
-    std::cout << "6. Search Transaction Type (List)\n";
-    std::cout << "7. Compare Performance (Array vs Linked List)\n";
-    std::cout << "8. Export to JSON\n";
-    std::cout << "9. Exit\n";
-    std::cout << "Enter choice: ";
+    ExternalSortOptions options;
+    std::string text;
+
+    std::cout << "Input CSV [" << loadedFile << "]: ";
+    std::getline(std::cin, options.inputFile);
+    if (options.inputFile.empty())
+        options.inputFile = loadedFile;
+
+    std::cout << "Sort column (any CSV column, e.g. location, amount, timestamp) [location]: ";
+    std::getline(std::cin, text);
+    if (!text.empty())
+        options.keyColumn = toLower(text);
+
+    std::cout << "Direction (asc/desc) [asc]: ";
+    std::getline(std::cin, text);
+    options.descending = toLower(text) == "desc";
+
+    std::cout << "Memory budget per run in KB [4096]: ";
+    std::getline(std::cin, text);
+    if (!text.empty())
+        options.memoryBudget = static_cast<size_t>(std::max(1L, std::atol(text.c_str()))) * 1024;
+
+    std::cout << "Output format (csv/json/binary) [csv]: ";
+    std::getline(std::cin, text);
+    text = toLower(text);
+    options.format = text == "json" ? EXTERNAL_OUTPUT_JSON : text == "binary" ? EXTERNAL_OUTPUT_BINARY : EXTERNAL_OUTPUT_CSV;
+
+    std::cout << "Output file: ";
+    std::getline(std::cin, options.outputFile);
+    if (options.outputFile.empty())
+    {
+        std::cout << "[ERROR] No output file given.\n";
+        return;
+    }
+
+    ExternalSortStats stats;
+    if (!externalSort(options, stats))
+        return;
+
+    std::cout << "[DONE] Sorted " << stats.rowsSorted << " rows (" << stats.rowsSkipped << " skipped) into "
+              << options.outputFile << "\n";
+    std::cout << "Run generation : " << stats.runs << " runs, read " << stats.runBytesRead << " bytes, wrote "
+              << stats.runBytesWritten << " bytes in " << stats.runMicros << " us\n";
+    std::cout << "Merge          : " << stats.mergePasses << " passes, read " << stats.mergeBytesRead << " bytes, wrote "
+              << stats.mergeBytesWritten << " bytes in " << stats.mergeMicros << " us\n";
 }
 
-void exportCustomJSON(TransactionArray &array, TransactionList &list)
+void printMemoryUsage(const TransactionStore &store, const TransactionArray &array,
+                      const TransactionList &list, const PartitionIndex &channelPartitions,
+                      const SortedIndexCache &sortedIndexes, const AccountIndex &accounts)
 {
-    int choice;
-    std::cout << "\nChoose export type:\n";
-    std::cout << "1. Full dataset (Array)\n";
-    std::cout << "2. Sorted by Location (Array)\n";
-    std::cout << "3. Sorted by Location (Linked List)\n";
-    std::cout << "4. Search by Transaction Type (Array)\n";
-    std::cout << "5. Search by Transaction Type (Linked List)\n";
-    std::cout << "Enter choice: ";
-    std::cin >> choice;
-    std::cin.ignore();
+    StoreMemoryUsage storeUsage = store.memoryUsage();
+    std::cout << "\n=== MEMORY USAGE ===\n";
+    std::cout << "Array pointer table     : " << array.memoryUsage() << " bytes\n";
+    std::cout << "Linked list nodes       : " << list.memoryUsage() << " bytes\n";
+    std::cout << "Channel partition index : " << channelPartitions.memoryUsage() << " bytes\n";
+    std::cout << "Sorted index cache      : " << sortedIndexes.memoryUsage() << " bytes ("
+              << sortedIndexes.builds << " built, " << sortedIndexes.patches << " patched, "
+              << sortedIndexes.hits << " hits)\n";
+    std::cout << "Account history index   : " << accounts.memoryUsage() << " bytes ("
+              << accounts.accountCount() << " accounts)\n";
+    std::cout << "Shared transaction store: " << storeUsage.total() << " bytes\n";
+    std::cout << "    records             : " << storeUsage.records << " bytes\n";
+    std::cout << "    string payloads     : " << storeUsage.strings << " bytes\n";
+    std::cout << "    numeric columns     : " << storeUsage.numeric << " bytes\n";
+    std::cout << "    dictionaries        : " << storeUsage.dictionaries << " bytes\n";
+    std::cout << "    zone maps           : " << storeUsage.zoneMaps << " bytes\n";
+    std::cout << "    hash indexes        : " << storeUsage.hashIndexes << " bytes\n";
+    std::cout << "    row bitmaps         : " << storeUsage.bitmaps << " bytes\n";
+    std::cout << "    range indexes       : " << storeUsage.rangeIndexes << " bytes\n";
+    std::cout << "    transaction id index: " << storeUsage.idIndex << " bytes (load factor "
+              << store.transactionIds().loadFactor() << ")\n";
+
+    size_t rss = processResidentBytes();
+    if (rss > 0)
+        std::cout << "Process RSS             : " << rss << " bytes\n";
+}
+
+// Prompts for one column and a range (or a value for categorical columns) and
+// runs it through the store's segment-skipping scan
+void runZoneMapQuery(const TransactionStore &store)
+{
+    std::string columnName;
+    std::cout << "Query column (amount, timestamp, a score such as velocity_score,\n"
+              << "              or a categorical column such as location): ";
+    std::getline(std::cin, columnName);
+    columnName = toLower(columnName);
+
+    CategoricalColumn categorical;
+    ScoreColumn score;
+    std::vector<uint32_t> matches;
+    ScanStats stats;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if (parseCategoricalColumn(columnName, categorical))
+    {
+        std::string value;
+        std::cout << "Value: ";
+        std::getline(std::cin, value);
+        start = std::chrono::high_resolution_clock::now();
+        matches = store.scanCodes(categorical, store.dictionary(categorical).lookupIgnoreCase(value), stats);
+    }
+    else if (columnName == "timestamp")
+    {
+        std::string from, to;
+        int64_t lo, hi;
+        std::cout << "From (YYYY-MM-DD[Thh:mm[:ss]]): ";
+        std::getline(std::cin, from);
+        std::cout << "To   (YYYY-MM-DD[Thh:mm[:ss]]): ";
+        std::getline(std::cin, to);
+        if (!parseTimestamp(from, lo) || !parseTimestamp(to, hi))
+        {
+            std::cout << "[ERROR] Invalid timestamp.\n";
+            return;
+        }
+        start = std::chrono::high_resolution_clock::now();
+        matches = store.scanTimestampRange(lo, hi, stats);
+    }
+    else if (columnName == "amount" || parseScoreColumn(columnName, score))
+    {
+        double lo, hi;
+        std::cout << "Lower bound: ";
+        std::cin >> lo;
+        std::cout << "Upper bound: ";
+        std::cin >> hi;
+        std::cin.ignore();
+        start = std::chrono::high_resolution_clock::now();
+        matches = columnName == "amount" ? store.scanAmountRange(lo, hi, stats)
+                                         : store.scanScoreRange(score, lo, hi, stats);
+    }
+    else
+    {
+        std::cout << "[ERROR] Unknown column: " << columnName << "\n";
+        return;
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "[INFO] " << matches.size() << " matching transactions. Visited "
+              << stats.segmentsVisited << " of " << store.segmentCount() << " segments ("
+              << stats.segmentsSkipped << " skipped) in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us\n";
 
+    for (size_t i = 0; i < matches.size() && i < 20; ++i)
+        printRow(store, store.row(matches[i]));
+}
+
+// Asks for a JSON filename and writes the given rows to it in that order;
+// a blank name skips the export
+void promptExportRows(const TransactionStore &store, const std::vector<uint32_t> &rowIds)
+{
     std::string filename;
-    std::cout << "Enter filename: ";
+    std::cout << "Export matches to JSON file (blank to skip): ";
     std::getline(std::cin, filename);
+    if (filename.empty())
+        return;
     if (filename.size() < 5 || filename.substr(filename.size() - 5) != ".json")
         filename += ".json";
 
     json jArray = json::array();
+    for (uint32_t rowId : rowIds)
+        jArray.push_back(transactionToJSON(store, store.row(rowId)));
+    std::ofstream out(filename);
+    if (!out)
+    {
+        std::cerr << "[ERROR] Failed to write to JSON file.\n";
+        return;
+    }
+    out << std::setw(4) << jArray << std::endl;
+    std::cout << "[SUCCESS] Exported " << rowIds.size() << " transactions to " << filename << "\n";
+}
 
-    if (choice == 1)
+// Prompts for a predicate query such as
+//   payment_channel = UPI AND transaction_type IN (transfer, payment)
+//   AND amount BETWEEN 5000 AND 10000 AND NOT device_used = mobile
+// and prints its plan, a summary and the first matches before offering an export
+void runQuery(const TransactionStore &store, const AccountIndex &accounts)
+{
+    std::string text;
+    std::cout << "Query (=, !=, IN, <, <=, >, >=, BETWEEN, PREFIX; AND / OR / NOT; quote values with spaces):\n> ";
+    std::getline(std::cin, text);
+
+    PredicateParser parser;
+    std::string error;
+    std::unique_ptr<Predicate> query = parser.parse(text, error);
+    if (!query)
     {
-        for (int i = 0; i < array.getSize(); ++i)
-        {
-            Transaction *t = array.getData()[i];
-            json jt;
-            jt["transaction_id"] = t->transaction_id;
-            jt["timestamp"] = t->timestamp;
-            jt["sender_account"] = t->sender_account;
-            jt["receiver_account"] = t->receiver_account;
-            jt["amount"] = t->amount;
-            jt["transaction_type"] = t->transaction_type;
-            jt["merchant_category"] = t->merchant_category;
-            jt["location"] = t->location;
-            jt["device_used"] = t->device_used;
-            jt["is_fraud"] = t->is_fraud;
-            jt["fraud_type"] = t->fraud_type;
-            jt["time_since_last_transaction"] = t->time_since_last_transaction;
-            jt["spending_deviation_score"] = t->spending_deviation_score;
-            jt["velocity_score"] = t->velocity_score;
-            jt["geo_anomaly_score"] = t->geo_anomaly_score;
-            jt["payment_channel"] = t->payment_channel;
-            jt["ip_address"] = t->ip_address;
-            jt["device_hash"] = t->device_hash;
-            jArray.push_back(jt);
-        }
+        std::cout << "[ERROR] " << error << "\n";
+        return;
     }
-    else if (choice == 2)
+
+    QueryEngine engine(store, &accounts);
+    auto start = std::chrono::high_resolution_clock::now();
+    RowBitmap selection = engine.run(*query);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "[INFO] " << selection.cardinality() << " matching transactions in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us\nPlan:\n";
+    engine.explain(*query);
+
+    SelectionSummary summary = summarizeSelection(store, selection);
+    if (summary.rows > 0)
     {
-        array.sortByLocation();
-        for (int i = 0; i < array.getSize(); ++i)
-        {
-            Transaction *t = array.getData()[i];
-            json jt;
-            jt["transaction_id"] = t->transaction_id;
-            jt["timestamp"] = t->timestamp;
-            jt["sender_account"] = t->sender_account;
-            jt["receiver_account"] = t->receiver_account;
-            jt["amount"] = t->amount;
-            jt["transaction_type"] = t->transaction_type;
-            jt["merchant_category"] = t->merchant_category;
-            jt["location"] = t->location;
-            jt["device_used"] = t->device_used;
-            jt["is_fraud"] = t->is_fraud;
-            jt["fraud_type"] = t->fraud_type;
-            jt["time_since_last_transaction"] = t->time_since_last_transaction;
-            jt["spending_deviation_score"] = t->spending_deviation_score;
-            jt["velocity_score"] = t->velocity_score;
-            jt["geo_anomaly_score"] = t->geo_anomaly_score;
-            jt["payment_channel"] = t->payment_channel;
-            jt["ip_address"] = t->ip_address;
-            jt["device_hash"] = t->device_hash;
-            jArray.push_back(jt);
-        }
+        std::streamsize precision = std::cout.precision();
+        std::cout << "Total amount: " << std::fixed << std::setprecision(2) << summary.totalCents / 100.0
+                  << ", average: " << summary.totalCents / 100.0 / summary.rows
+                  << ", min: " << summary.minAmount << ", max: " << summary.maxAmount << std::defaultfloat
+                  << std::setprecision(precision) << ", fraud: " << summary.fraudRows << " of " << summary.rows << "\n";
     }
-    else if (choice == 3)
+
+    std::vector<uint32_t> rowIds = selection.toRowIds();
+    for (size_t i = 0; i < rowIds.size() && i < 20; ++i)
+        printRow(store, store.row(rowIds[i]));
+
+    promptExportRows(store, rowIds);
+}
+
+// Prompts for a column (amount, timestamp or time of day) and bounds, and
+// answers from the store's ordered range index: count, first rows, export
+void runRangeIndexQuery(const TransactionStore &store)
+{
+    std::string columnName, from, to;
+    std::cout << "Range column (amount, timestamp, time_of_day): ";
+    std::getline(std::cin, columnName);
+    columnName = toLower(columnName);
+    std::cout << "From: ";
+    std::getline(std::cin, from);
+    std::cout << "To  : ";
+    std::getline(std::cin, to);
+
+    RangeColumn column;
+    int64_t lo, hi;
+    if (columnName == "amount")
     {
-        list.sortByLocation();
-        Node *curr = *((Node **)(&list));
-        while (curr)
+        char *fromEnd, *toEnd;
+        double loAmount = std::strtod(from.c_str(), &fromEnd), hiAmount = std::strtod(to.c_str(), &toEnd);
+        if (fromEnd == from.c_str() || toEnd == to.c_str())
         {
-            Transaction *t = curr->data;
-            json jt;
-            jt["transaction_id"] = t->transaction_id;
-            jt["timestamp"] = t->timestamp;
-            jt["sender_account"] = t->sender_account;
-            jt["receiver_account"] = t->receiver_account;
-            jt["amount"] = t->amount;
-            jt["transaction_type"] = t->transaction_type;
-            jt["merchant_category"] = t->merchant_category;
-            jt["location"] = t->location;
-            jt["device_used"] = t->device_used;
-            jt["is_fraud"] = t->is_fraud;
-            jt["fraud_type"] = t->fraud_type;
-            jt["time_since_last_transaction"] = t->time_since_last_transaction;
-            jt["spending_deviation_score"] = t->spending_deviation_score;
-            jt["velocity_score"] = t->velocity_score;
-            jt["geo_anomaly_score"] = t->geo_anomaly_score;
-            jt["payment_channel"] = t->payment_channel;
-            jt["ip_address"] = t->ip_address;
-            jt["device_hash"] = t->device_hash;
-            jArray.push_back(jt);
-            curr = curr->next;
+            std::cout << "[ERROR] Invalid amount.\n";
+            return;
         }
+        column = RANGE_AMOUNT;
+        lo = static_cast<int64_t>(std::ceil(loAmount * 100.0 - 1e-6));
+        hi = static_cast<int64_t>(std::floor(hiAmount * 100.0 + 1e-6));
     }
-    else if (choice == 4)
+    else if (columnName == "timestamp")
     {
-        std::string type;
-        std::cout << "Enter transaction type to search (array): ";
-        std::getline(std::cin, type);
-        array.sortByTransactionType();
-
-        for (int i = 0; i < array.getSize(); ++i)
+        column = RANGE_TIMESTAMP;
+        if (!parseTimestamp(from, lo) || !parseTimestamp(to, hi))
         {
-            if (toLower(array.getData()[i]->transaction_type) == toLower(type))
-            {
-                Transaction *t = array.getData()[i];
-                json jt;
-                jt["transaction_id"] = t->transaction_id;
-                jt["timestamp"] = t->timestamp;
-                jt["sender_account"] = t->sender_account;
-                jt["receiver_account"] = t->receiver_account;
-                jt["amount"] = t->amount;
-                jt["transaction_type"] = t->transaction_type;
-                jt["merchant_category"] = t->merchant_category;
-                jt["location"] = t->location;
-                jt["device_used"] = t->device_used;
-                jt["is_fraud"] = t->is_fraud;
-                jt["fraud_type"] = t->fraud_type;
-                jt["time_since_last_transaction"] = t->time_since_last_transaction;
-                jt["spending_deviation_score"] = t->spending_deviation_score;
-                jt["velocity_score"] = t->velocity_score;
-                jt["geo_anomaly_score"] = t->geo_anomaly_score;
-                jt["payment_channel"] = t->payment_channel;
-                jt["ip_address"] = t->ip_address;
-                jt["device_hash"] = t->device_hash;
-                jArray.push_back(jt);
-            }
+            std::cout << "[ERROR] Invalid timestamp (YYYY-MM-DD[Thh:mm[:ss]]).\n";
+            return;
         }
     }
-    else if (choice == 5)
+    else if (columnName == "time_of_day" || columnName == "time")
     {
-        std::string type;
-        std::cout << "Enter transaction type to search (linked list): ";
-        std::getline(std::cin, type);
-        list.sortByTransactionType();
-
-        Node *curr = *((Node **)(&list));
-        while (curr)
+        // "hh:mm[:ss]" read as a time on the epoch day
+        column = RANGE_TIME_OF_DAY;
+        if (!parseTimestamp("1970-01-01T" + from, lo) || !parseTimestamp("1970-01-01T" + to, hi))
         {
-            if (toLower(curr->data->transaction_type) == toLower(type))
-            {
-                Transaction *t = curr->data;
-                json jt;
-                jt["transaction_id"] = t->transaction_id;
-                jt["timestamp"] = t->timestamp;
-                jt["sender_account"] = t->sender_account;
-                jt["receiver_account"] = t->receiver_account;
-                jt["amount"] = t->amount;
-                jt["transaction_type"] = t->transaction_type;
-                jt["merchant_category"] = t->merchant_category;
-                jt["location"] = t->location;
-                jt["device_used"] = t->device_used;
-                jt["is_fraud"] = t->is_fraud;
-                jt["fraud_type"] = t->fraud_type;
-                jt["time_since_last_transaction"] = t->time_since_last_transaction;
-                jt["spending_deviation_score"] = t->spending_deviation_score;
-                jt["velocity_score"] = t->velocity_score;
-                jt["geo_anomaly_score"] = t->geo_anomaly_score;
-                jt["payment_channel"] = t->payment_channel;
-                jt["ip_address"] = t->ip_address;
-                jt["device_hash"] = t->device_hash;
-                jArray.push_back(jt);
-            }
-            curr = curr->next;
+            std::cout << "[ERROR] Invalid time of day (hh:mm[:ss]).\n";
+            return;
         }
     }
     else
     {
-        std::cout << "[ERROR] Invalid export type.\n";
+        std::cout << "[ERROR] Unknown range column: " << columnName << "\n";
         return;
     }
 
-    std::ofstream out(filename);
-    if (!out)
+    const RangeIndex &index = store.rangeIndex(column);
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<uint32_t> rowIds;
+    if (column == RANGE_TIME_OF_DAY && lo > hi)
     {
-        std::cerr << "[ERROR] Failed to write to JSON file.\n";
-        return;
+        // a window across midnight, e.g. 23:00 to 01:00
+        rowIds = index.rangeRowIds(lo, MICROS_PER_DAY - 1);
+        std::vector<uint32_t> early = index.rangeRowIds(0, hi);
+        rowIds.insert(rowIds.end(), early.begin(), early.end());
     }
-    out << std::setw(4) << jArray << std::endl;
-    std::cout << "[SUCCESS] Exported to " << filename << "\n";
+    else
+        rowIds = index.rangeRowIds(lo, hi);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "[INFO] " << rowIds.size() << " matching transactions in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
+              << " us (ordered index, " << index.size() << " keys)\n";
+    for (size_t i = 0; i < rowIds.size() && i < 20; ++i)
+        printRow(store, store.row(rowIds[i]));
+
+    promptExportRows(store, rowIds);
 }
 
-size_t estimateArrayMemory(const TransactionArray &arr)
+// Prompts for an account and lists what it sent and received, oldest first,
+// from the account index
+void runAccountHistory(const TransactionStore &store, const AccountIndex &accounts)
 {
-    return arr.getSize() * sizeof(Transaction *) + arr.getSize() * sizeof(Transaction);
+    std::string account;
+    std::cout << "Account (e.g. ACC3235): ";
+    std::getline(std::cin, account);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<uint32_t> rowIds = accounts.history(store, account);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "[INFO] " << account << ": " << accounts.sent(account).size() << " sent, "
+              << accounts.received(account).size() << " received, looked up in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us\n";
+    for (size_t i = 0; i < rowIds.size() && i < 20; ++i)
+    {
+        const Transaction *t = store.row(rowIds[i]);
+        std::cout << (store.detailsOf(t).sender_account == account ? "[sent]     " : "[received] ");
+        printRow(store, t);
+    }
+
+    promptExportRows(store, rowIds);
 }
 
-size_t estimateListMemory(const TransactionList &list)
+// Prompts for a numeric column, K, direction and an optional filter, and
+// prints the top-K rows without sorting the data
+void runTopKQuery(const TransactionStore &store)
 {
-    size_t total = 0;
-    Node *current = *((Node **)(&list));
-    while (current)
+    const NumericColumns &numbers = store.numbers();
+    std::string columnName, text;
+    std::cout << "Column (amount, timestamp, or a score such as geo_anomaly_score): ";
+    std::getline(std::cin, columnName);
+    columnName = toLower(columnName);
+    ScoreColumn score = SCORE_TIME_SINCE_LAST;
+    if (columnName != "amount" && columnName != "timestamp" && !parseScoreColumn(columnName, score))
+    {
+        std::cout << "[ERROR] Unknown column: " << columnName << "\n";
+        return;
+    }
+
+    std::cout << "K [100]: ";
+    std::getline(std::cin, text);
+    size_t k = text.empty() ? 100 : static_cast<size_t>(std::max(0L, std::atol(text.c_str())));
+
+    std::cout << "Largest or smallest (largest/smallest) [largest]: ";
+    std::getline(std::cin, text);
+    bool largest = toLower(text) != "smallest";
+
+    // Optional filter: "fraud" or "<categorical column>=<value>"
+    std::cout << "Filter (fraud, column=value, or empty for none): ";
+    std::getline(std::cin, text);
+    bool fraudOnly = toLower(text) == "fraud";
+    bool byCode = false;
+    CategoricalColumn filterColumn = COL_TRANSACTION_TYPE;
+    std::vector<uint32_t> filterCodes;
+    size_t equals = text.find('=');
+    if (!fraudOnly && equals != std::string::npos)
+    {
+        if (!parseCategoricalColumn(text.substr(0, equals), filterColumn))
+        {
+            std::cout << "[ERROR] Unknown column: " << text.substr(0, equals) << "\n";
+            return;
+        }
+        byCode = true;
+        filterCodes = store.dictionary(filterColumn).lookupIgnoreCase(text.substr(equals + 1));
+    }
+    else if (!fraudOnly && !text.empty())
+    {
+        std::cout << "[ERROR] Invalid filter: " << text << "\n";
+        return;
+    }
+
+    unsigned hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "Threads [" << hardwareThreads << "]: ";
+    std::getline(std::cin, text);
+    unsigned threadCount = text.empty() ? hardwareThreads : static_cast<unsigned>(std::max(1, std::atoi(text.c_str())));
+
+    auto filter = [&](uint32_t rowId)
+    {
+        if (fraudOnly && !numbers.isFraud(rowId))
+            return false;
+        if (byCode)
+        {
+            uint32_t code = store.row(rowId)->codes[filterColumn];
+            return std::find(filterCodes.begin(), filterCodes.end(), code) != filterCodes.end();
+        }
+        return true;
+    };
+    auto run = [&](auto key)
+    { return topK(store, k, largest, key, filter, threadCount); };
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<TopKEntry> top;
+    if (columnName == "amount")
+        top = run([&numbers](uint32_t rowId)
+                  { return numbers.amount(rowId); });
+    else if (columnName == "timestamp")
+        top = run([&numbers](uint32_t rowId)
+                  { return numbers.timestamp(rowId); });
+    else
+        top = run([&numbers, score](uint32_t rowId)
+                  { return numbers.score(score, rowId); });
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "[INFO] Top " << top.size() << " by " << columnName << (largest ? " (largest)" : " (smallest)")
+              << " in " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us\n";
+    for (const TopKEntry &entry : top)
     {
-        total += sizeof(Node) + sizeof(Transaction);
-        current = current->next;
+        // printRow already shows amount and timestamp; scores are prefixed
+        const Transaction *t = store.row(entry.rowId);
+        if (columnName != "amount" && columnName != "timestamp")
+            std::cout << numbers.displayScore(score, entry.rowId) << " | ";
+        printRow(store, t);
     }
-    return total;
 }
 
-void runSortBenchmark(TransactionArray &array, TransactionList &fullList)
+void runSortBenchmark(const TransactionStore &store, TransactionArray &array, TransactionList &fullList)
 {
     std::cout << "\nRUNTIME CALCULATION\n\n";
 
+    //____________TRAVERSAL (hot records only)_________
+    std::cout << "Hot record: " << sizeof(Transaction) << " bytes/row, cold details: "
+              << sizeof(TransactionDetails) << " bytes/row (read only by print/export)\n";
+    array.benchmarkOperation();
+    fullList.benchmarkOperation();
+    std::cout << "\n";
+
     //____________LOCATION_____________________________
 
 
@@ -868,9 +5522,10 @@ void runSortBenchmark(TransactionArray &array, TransactionList &fullList)
 
     //COLLECT UNIQUE TRANSACTION TYPES
     std::set<std::string> uniqueTypes;
-    for (int i = 0; i < array.getSize(); ++i)
+    const Dictionary &types = store.dictionary(COL_TRANSACTION_TYPE);
+    for (uint32_t code = 0; code < types.size(); ++code)
     {
-        uniqueTypes.insert(toLower(array.getData()[i]->transaction_type));
+        uniqueTypes.insert(types.folded(code));
     }
 
     //MEASURE TOTAL SEARCH TIME FOR ALL TYPES (ARRAY) 
@@ -893,6 +5548,16 @@ void runSortBenchmark(TransactionArray &array, TransactionList &fullList)
         totalListSearchTime += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
     }
 
+    //MEASURE TOTAL SEARCH TIME FOR ALL TYPES (HASH INDEX)
+    long long totalIndexSearchTime = 0;
+    for (const std::string &type : uniqueTypes)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        benchmarkIndexSearch(store, type);
+        auto end = std::chrono::high_resolution_clock::now();
+        totalIndexSearchTime += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    }
+
     //PRINT OUTPUT
     std::cout << "[ ARRAY ]\n";
     std::cout << "Searching (transaction type) : " << totalArraySearchTime << " ns\n";
@@ -900,33 +5565,536 @@ void runSortBenchmark(TransactionArray &array, TransactionList &fullList)
 
     std::cout << "[ LINKEDLIST ]\n";
     std::cout << "Searching (transaction type ) : " << totalListSearchTime << " ns\n";
-    std::cout << "Sorting  ( location ) : " << listSortTime << " ns\n";
+    std::cout << "Sorting  ( location ) : " << listSortTime << " ns\n\n";
+
+    std::cout << "[ HASH INDEX ]\n";
+    std::cout << "Searching (transaction type) : " << totalIndexSearchTime << " ns\n";
 
     //store results for option 7
     benchmark.arraySortTime = arraySortTime;
     benchmark.listSortTime = listSortTime;
     benchmark.arraySearchTime = totalArraySearchTime;
     benchmark.listSearchTime = totalListSearchTime;
+    benchmark.indexSearchTime = totalIndexSearchTime;
+
+
+
+
+}
+
+// Times both transaction_type sort modes on fresh load-order copies of the data
+// and counts the heap allocations each one makes
+void runTypeSortBenchmark(const TransactionStore &store)
+{
+    const char *modeNames[] = {"fold per compare", "precomputed key", "radix"};
+    const int modeCount = 3;
+    std::vector<std::string> orders[2][modeCount];
+
+    std::cout << std::left << std::setw(14) << "Container" << std::setw(20) << "Mode"
+              << std::setw(14) << "Time (us)" << "Allocations\n";
+    std::cout << std::string(60, '-') << "\n";
+
+    for (int m = 0; m < modeCount; ++m)
+    {
+        TypeSortMode mode = static_cast<TypeSortMode>(m);
+
+        TransactionArray array(store);
+        for (uint32_t row = 0; row < store.size(); ++row)
+            array.insert(store.row(row));
+        size_t allocationsBefore = heapAllocationCount.load();
+        auto start = std::chrono::high_resolution_clock::now();
+        array.sortByTransactionType(mode);
+        auto end = std::chrono::high_resolution_clock::now();
+        size_t allocations = heapAllocationCount.load() - allocationsBefore;
+        std::cout << std::setw(14) << "Array" << std::setw(20) << modeNames[m]
+                  << std::setw(14) << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
+                  << allocations << "\n";
+        for (int i = 0; i < array.getSize(); ++i)
+            orders[0][m].push_back(store.foldedValue(array.getData()[i], COL_TRANSACTION_TYPE));
+
+        TransactionList list(store);
+        for (uint32_t row = 0; row < store.size(); ++row)
+            list.append(store.row(row));
+        allocationsBefore = heapAllocationCount.load();
+        start = std::chrono::high_resolution_clock::now();
+        list.sortByTransactionType(mode);
+        end = std::chrono::high_resolution_clock::now();
+        allocations = heapAllocationCount.load() - allocationsBefore;
+        std::cout << std::setw(14) << "Linked List" << std::setw(20) << modeNames[m]
+                  << std::setw(14) << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
+                  << allocations << "\n";
+        for (Node *curr = list.getHead(); curr; curr = curr->next)
+            orders[1][m].push_back(store.foldedValue(curr->data, COL_TRANSACTION_TYPE));
+    }
+    std::cout << std::right;
+
+    bool same = true;
+    for (int m = 1; m < modeCount; ++m)
+        same = same && orders[0][0] == orders[0][m] && orders[1][0] == orders[1][m];
+    std::cout << (same ? "[INFO] All modes produce the same type order.\n"
+                       : "[ERROR] Sort modes disagree on the type order.\n");
+}
+
+// Sorts fresh load-order copies of the data by location with the comparison
+// sorts and with the radix sort, checking that the results agree
+void runRadixSortBenchmark(const TransactionStore &store)
+{
+    const char *algorithmNames[] = {"comparison", "radix"};
+    std::vector<uint32_t> orders[2][2];
+
+    std::cout << std::left << std::setw(14) << "Container" << std::setw(14) << "Algorithm"
+              << "Time (us)\n";
+    std::cout << std::string(40, '-') << "\n";
+
+    for (int a = 0; a < 2; ++a)
+    {
+        SortAlgorithm algorithm = static_cast<SortAlgorithm>(a);
+
+        TransactionArray array(store);
+        for (uint32_t row = 0; row < store.size(); ++row)
+            array.insert(store.row(row));
+        auto start = std::chrono::high_resolution_clock::now();
+        array.sortByLocation(algorithm);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout << std::setw(14) << "Array" << std::setw(14) << algorithmNames[a]
+                  << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << "\n";
+        for (int i = 0; i < array.getSize(); ++i)
+            orders[0][a].push_back(array.getData()[i]->codes[COL_LOCATION]);
+
+        TransactionList list(store);
+        for (uint32_t row = 0; row < store.size(); ++row)
+            list.append(store.row(row));
+        start = std::chrono::high_resolution_clock::now();
+        list.sortByLocation(algorithm);
+        end = std::chrono::high_resolution_clock::now();
+        std::cout << std::setw(14) << "Linked List" << std::setw(14) << algorithmNames[a]
+                  << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << "\n";
+        for (Node *curr = list.getHead(); curr; curr = curr->next)
+            orders[1][a].push_back(curr->data->codes[COL_LOCATION]);
+    }
+    std::cout << std::right;
+
+    bool same = orders[0][0] == orders[0][1] && orders[1][0] == orders[1][1];
+    std::cout << (same ? "[INFO] Radix and comparison sorts produce the same location order.\n"
+                       : "[ERROR] Radix and comparison sorts disagree on the location order.\n");
+}
+
+// Times the parallel sort against the sequential sorts on fresh load-order
+// copies, for a categorical key (location) and a numeric key (amount), and
+// checks the parallel result is exactly the sequential stable order (and has
+// the same key order as the unstable introsort)
+void runParallelSortBenchmark(const TransactionStore &store)
+{
+    unsigned hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::string threadsText;
+    std::cout << "Threads [" << hardwareThreads << "]: ";
+    std::getline(std::cin, threadsText);
+    unsigned threadCount = threadsText.empty() ? hardwareThreads : static_cast<unsigned>(std::max(1, std::atoi(threadsText.c_str())));
+
+    std::vector<uint32_t> locationRank = store.dictionary(COL_LOCATION).sortedRanks();
+    auto byLocation = [&locationRank](const Transaction *a, const Transaction *b)
+    { return locationRank[a->codes[COL_LOCATION]] < locationRank[b->codes[COL_LOCATION]]; };
+    auto byAmount = [&store](const Transaction *a, const Transaction *b)
+    { return store.amount(a) < store.amount(b); };
+
+    auto loadOrder = [&store](TransactionArray &array)
+    {
+        for (uint32_t row = 0; row < store.size(); ++row)
+            array.insert(store.row(row));
+    };
+    auto elapsed = [](std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::high_resolution_clock::now() - start)
+            .count();
+    };
+
+    std::cout << std::left << std::setw(10) << "Key" << std::setw(28) << "Sort" << "Time (us)\n";
+    std::cout << std::string(48, '-') << "\n";
+
+    bool same = true;
+    for (int key = 0; key < 2; ++key)
+    {
+        const char *keyName = key == 0 ? "location" : "amount";
+
+        TransactionArray sequential(store);
+        loadOrder(sequential);
+        auto start = std::chrono::high_resolution_clock::now();
+        if (key == 0)
+            std::stable_sort(sequential.getData(), sequential.getData() + sequential.getSize(), byLocation);
+        else
+            std::stable_sort(sequential.getData(), sequential.getData() + sequential.getSize(), byAmount);
+        std::cout << std::setw(10) << keyName << std::setw(28) << "sequential stable_sort" << elapsed(start) << "\n";
+
+        if (key == 0)
+        {
+            TransactionArray quick(store);
+            loadOrder(quick);
+            start = std::chrono::high_resolution_clock::now();
+            quick.sortByLocation();
+            std::cout << std::setw(10) << keyName << std::setw(28) << "sequential introsort" << elapsed(start) << "\n";
+            for (int i = 0; i < quick.getSize(); ++i)
+                same = same && quick.getData()[i]->codes[COL_LOCATION] == sequential.getData()[i]->codes[COL_LOCATION];
+        }
+
+        TransactionArray parallel(store);
+        loadOrder(parallel);
+        start = std::chrono::high_resolution_clock::now();
+        if (key == 0)
+            parallel.parallelSort(byLocation, threadCount);
+        else
+            parallel.parallelSort(byAmount, threadCount);
+        std::string label = "parallel, " + std::to_string(threadCount) + " thread" + (threadCount == 1 ? "" : "s");
+        std::cout << std::setw(10) << keyName << std::setw(28) << label << elapsed(start) << "\n";
+        same = same && std::equal(parallel.getData(), parallel.getData() + parallel.getSize(), sequential.getData());
+    }
+    std::cout << std::right;
+
+    std::cout << (same ? "[INFO] Parallel and sequential sorts produce the same order.\n"
+                       : "[ERROR] Parallel and sequential sorts disagree.\n");
+}
+
+// Compares the original quickSort with the introsort on the loaded location
+// distribution in load order, already sorted and reverse sorted
+void runIntroSortBenchmark(const TransactionStore &store)
+{
+    const char *inputNames[] = {"load order", "sorted", "reversed"};
+    const char *sortNames[] = {"quickSort (strings)", "introsort (strings)", "introsort (ranks)"};
+    std::vector<uint32_t> rank = store.dictionary(COL_LOCATION).sortedRanks();
+    auto byString = [&store](const Transaction *a, const Transaction *b)
+    { return store.value(a, COL_LOCATION) < store.value(b, COL_LOCATION); };
+    auto byRank = [&rank](const Transaction *a, const Transaction *b)
+    { return rank[a->codes[COL_LOCATION]] < rank[b->codes[COL_LOCATION]]; };
+
+    std::cout << std::left << std::setw(12) << "Input" << std::setw(22) << "Sort" << "Time (us)\n";
+    std::cout << std::string(44, '-') << "\n";
+
+    bool same = true;
+    for (int input = 0; input < 3; ++input)
+    {
+        std::vector<uint32_t> reference;
+        for (int sortKind = 0; sortKind < 3; ++sortKind)
+        {
+            TransactionArray array(store);
+            for (uint32_t row = 0; row < store.size(); ++row)
+                array.insert(store.row(row));
+            if (input > 0)
+                std::stable_sort(array.getData(), array.getData() + array.getSize(), byRank);
+            if (input == 2)
+                std::reverse(array.getData(), array.getData() + array.getSize());
+
+            auto start = std::chrono::high_resolution_clock::now();
+            if (sortKind == 0)
+                array.quickSort(0, array.getSize() - 1);
+            else if (sortKind == 1)
+                array.introSort(byString);
+            else
+                array.introSort(byRank);
+            auto end = std::chrono::high_resolution_clock::now();
+            std::cout << std::setw(12) << inputNames[input] << std::setw(22) << sortNames[sortKind]
+                      << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << "\n";
+
+            std::vector<uint32_t> order;
+            for (int i = 0; i < array.getSize(); ++i)
+                order.push_back(array.getData()[i]->codes[COL_LOCATION]);
+            if (sortKind == 0)
+                reference = order;
+            same = same && order == reference;
+        }
+    }
+    std::cout << std::right;
+
+    std::cout << (same ? "[INFO] All sorts produce the same location order.\n"
+                       : "[ERROR] The sorts disagree on the location order.\n");
+}
+
+// Sorts both containers by location asc, amount desc, timestamp asc through
+// the multi-key comparator, with load order as the final tie-break so the
+// array and the list must come out identical
+void runMultiKeySort(TransactionArray &array, TransactionList &list)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    array.sortBy<SortKey<CategoricalField<COL_LOCATION>>, SortKey<AmountField, SORT_DESCENDING>,
+                 SortKey<TimestampField>, SortKey<RowIdField>>();
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "[INFO] Array sorted in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us\n";
+
+    start = std::chrono::high_resolution_clock::now();
+    list.sortBy<SortKey<CategoricalField<COL_LOCATION>>, SortKey<AmountField, SORT_DESCENDING>,
+                SortKey<TimestampField>, SortKey<RowIdField>>();
+    end = std::chrono::high_resolution_clock::now();
+    std::cout << "[INFO] Linked list sorted in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us\n";
+
+    bool same = true;
+    Node *curr = list.getHead();
+    for (int i = 0; i < array.getSize() && curr; ++i, curr = curr->next)
+        same = same && array.getData()[i] == curr->data;
+    std::cout << (same ? "[INFO] Array and list orders match.\n"
+                       : "[ERROR] Array and list orders differ.\n");
+
+    std::cout << "\n-- Array Data --\n";
+    array.print(20);
+}
+
+// Times the adaptive sorts against the existing comparison sorts by amount on
+// inputs of decreasing presortedness, all built from the loaded rows with a
+// fixed seed, and checks the stable sorts agree
+void runAdaptiveSortBenchmark(const TransactionStore &store)
+{
+    const NumericColumns &numbers = store.numbers();
+    auto byAmount = [&numbers](const Transaction *a, const Transaction *b)
+    { return numbers.amount(a->row_id) < numbers.amount(b->row_id); };
+
+    std::vector<Transaction *> sorted;
+    for (uint32_t row = 0; row < store.size(); ++row)
+        sorted.push_back(store.row(row));
+    std::vector<Transaction *> loadOrder = sorted;
+    std::stable_sort(sorted.begin(), sorted.end(), byAmount);
+
+    const char *inputNames[] = {"sorted", "1% displaced", "10% displaced", "5% appended", "reversed", "load order"};
+    const char *sortNames[] = {"array introsort", "array stable_sort", "array adaptive",
+                               "list merge sort", "list natural merge"};
+
+    std::cout << std::left << std::setw(16) << "Input";
+    for (const char *name : sortNames)
+        std::cout << std::setw(20) << name;
+    std::cout << "(us)\n" << std::string(116, '-') << "\n";
+
+    bool same = true;
+    std::mt19937 rng(42);
+    for (int input = 0; input < 6; ++input)
+    {
+        std::vector<Transaction *> rows = sorted;
+        size_t n = rows.size();
+        if (input == 1 || input == 2)
+        {
+            size_t swaps = n * (input == 1 ? 1 : 10) / 200;
+            for (size_t s = 0; s < swaps && n > 0; ++s)
+                std::swap(rows[rng() % n], rows[rng() % n]);
+        }
+        else if (input == 3)
+        {
+            rows = loadOrder;
+            std::stable_sort(rows.begin(), rows.begin() + n * 95 / 100, byAmount);
+        }
+        else if (input == 4)
+            std::reverse(rows.begin(), rows.end());
+        else if (input == 5)
+            rows = loadOrder;
+
+        std::cout << std::setw(16) << inputNames[input];
+        std::vector<Transaction *> reference;
+        for (int sortKind = 0; sortKind < 5; ++sortKind)
+        {
+            TransactionArray array(store);
+            TransactionList list(store);
+            for (Transaction *t : rows)
+            {
+                if (sortKind < 3)
+                    array.insert(t);
+                else
+                    list.append(t);
+            }
+
+            auto start = std::chrono::high_resolution_clock::now();
+            if (sortKind == 0)
+                array.introSort(byAmount);
+            else if (sortKind == 1)
+                std::stable_sort(array.getData(), array.getData() + array.getSize(), byAmount);
+            else if (sortKind == 2)
+                array.adaptiveSort(byAmount);
+            else if (sortKind == 3)
+                list.sortBy<SortKey<AmountField>>();
+            else
+                list.naturalMergeSort(byAmount);
+            auto end = std::chrono::high_resolution_clock::now();
+            std::cout << std::setw(20) << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+            std::vector<Transaction *> order;
+            if (sortKind < 3)
+                order.assign(array.getData(), array.getData() + array.getSize());
+            else
+                for (Node *curr = list.getHead(); curr; curr = curr->next)
+                    order.push_back(curr->data);
+            if (sortKind == 1)
+                reference = order;
+            else if (sortKind > 1)
+                same = same && order == reference;
+        }
+        std::cout << "\n";
+    }
+    std::cout << std::right;
+
+    std::cout << (same ? "[INFO] All stable sorts produce the same order.\n"
+                       : "[ERROR] The stable sorts disagree.\n");
+}
+
+// Sorts fresh load-order copies of both containers on one string column with
+// full string comparisons and with the normalized prefix key sort
+void runPrefixSortBenchmark(const TransactionStore &store)
+{
+    std::string columnName;
+    std::cout << "String column (sender_account, receiver_account, transaction_id, device_hash,\n"
+              << "               or a categorical column such as location) [sender_account]: ";
+    std::getline(std::cin, columnName);
+    columnName = columnName.empty() ? "sender_account" : toLower(columnName);
+
+    CategoricalColumn column = COL_LOCATION;
+    std::string TransactionDetails::*field = nullptr;
+    if (columnName == "sender_account")
+        field = &TransactionDetails::sender_account;
+    else if (columnName == "receiver_account")
+        field = &TransactionDetails::receiver_account;
+    else if (columnName == "transaction_id")
+        field = &TransactionDetails::transaction_id;
+    else if (columnName == "device_hash")
+        field = &TransactionDetails::device_hash;
+    else if (!parseCategoricalColumn(columnName, column))
+    {
+        std::cout << "[ERROR] Unknown column: " << columnName << "\n";
+        return;
+    }
+
+    auto text = [&store, field, column](const Transaction *t) -> const std::string &
+    { return field ? store.detailsOf(t).*field : store.value(t, column); };
+    auto byText = [&text](const Transaction *a, const Transaction *b)
+    { return text(a) < text(b); };
+
+    std::cout << std::left << std::setw(14) << "Container" << std::setw(20) << "Sort" << "Time (us)\n";
+    std::cout << std::string(44, '-') << "\n";
+
+    std::vector<Transaction *> orders[4];
+    for (int kind = 0; kind < 4; ++kind)
+    {
+        TransactionArray array(store);
+        TransactionList list(store);
+        for (uint32_t row = 0; row < store.size(); ++row)
+        {
+            if (kind < 2)
+                array.insert(store.row(row));
+            else
+                list.append(store.row(row));
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        if (kind == 0)
+            std::stable_sort(array.getData(), array.getData() + array.getSize(), byText);
+        else if (kind == 1)
+            array.prefixKeySort(text);
+        else if (kind == 2)
+            list.mergeSort(byText);
+        else
+            list.prefixKeySort(text);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout << std::setw(14) << (kind < 2 ? "Array" : "Linked List")
+                  << std::setw(20) << (kind % 2 == 0 ? "string compare" : "prefix key")
+                  << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << "\n";
+
+        if (kind < 2)
+            orders[kind].assign(array.getData(), array.getData() + array.getSize());
+        else
+            for (Node *curr = list.getHead(); curr; curr = curr->next)
+                orders[kind].push_back(curr->data);
+    }
+    std::cout << std::right;
+
+    bool same = orders[0] == orders[1] && orders[0] == orders[2] && orders[0] == orders[3];
+    std::cout << (same ? "[INFO] Prefix key and string compare sorts produce the same order.\n"
+                       : "[ERROR] Prefix key and string compare sorts disagree.\n");
+}
 
+// Sorts linked lists of growing size by location, reusing the loaded rows as
+// often as needed, and checks each result is ordered with a correct tail
+void runListSortBenchmark(const TransactionStore &store)
+{
+    if (store.size() == 0)
+    {
+        std::cout << "[INFO] No transactions loaded.\n";
+        return;
+    }
+
+    std::string input;
+    long long maxNodes = 1000000;
+    std::cout << "Largest list size to sort [1000000]: ";
+    std::getline(std::cin, input);
+    if (!input.empty() && !(std::istringstream(input) >> maxNodes))
+    {
+        std::cout << "[ERROR] Invalid size: " << input << "\n";
+        return;
+    }
 
+    // Location order, a tail pointer at the last node and a node count that
+    // matches the nodes actually linked
+    auto wellFormed = [&store](const TransactionList &list, long long nodes)
+    {
+        long long linked = 0;
+        Node *last = nullptr;
+        for (Node *curr = list.getHead(); curr; last = curr, curr = curr->next, ++linked)
+        {
+            if (last && store.value(curr->data, COL_LOCATION) < store.value(last->data, COL_LOCATION))
+                return false;
+        }
+        return last == list.getTail() && linked == nodes && list.countNodes() == nodes;
+    };
+
+    std::cout << std::left << std::setw(14) << "Nodes" << std::setw(14) << "Sort (ms)"
+              << std::setw(12) << "ns/node" << std::setw(18) << "Skip insert (ms)" << "Result\n";
+    std::cout << std::string(66, '-') << "\n";
 
+    for (long long nodes = 10000; nodes <= maxNodes; nodes = nodes * 10 > maxNodes && nodes < maxNodes ? maxNodes : nodes * 10)
+    {
+        TransactionList list(store);
+        for (long long i = 0; i < nodes; ++i)
+            list.append(store.row(static_cast<uint32_t>(i % store.size())));
 
+        auto start = std::chrono::high_resolution_clock::now();
+        list.sortByLocation();
+        auto end = std::chrono::high_resolution_clock::now();
+        long long elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+        // The same rows inserted one by one through the skip-list layer
+        TransactionList inserted(store);
+        inserted.enableSkipIndex(ORDER_BY_LOCATION);
+        start = std::chrono::high_resolution_clock::now();
+        for (long long i = 0; i < nodes; ++i)
+            inserted.insertSorted(store.row(static_cast<uint32_t>(i % store.size())));
+        end = std::chrono::high_resolution_clock::now();
+        long long insertElapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+        std::cout << std::setw(14) << nodes << std::setw(14) << elapsed / 1000000.0
+                  << std::setw(12) << elapsed / nodes << std::setw(18) << insertElapsed / 1000000.0
+                  << (wellFormed(list, nodes) && wellFormed(inserted, nodes) ? "sorted, tail and count ok" : "NOT SORTED")
+                  << "\n";
+    }
+    std::cout << std::right;
 }
 
 int main()
 {
-    TransactionArray array;
-    TransactionList fullList, cardList, achList, upiList, wireList;
     int choice;
     std::string filename;
+    std::string modeName;
 
     std::cout << "Enter CSV filename: ";
     std::getline(std::cin, filename);
-    if (!loadCSV(array, fullList, cardList, achList, upiList, wireList, filename)) {
+    std::cout << "Storage mode (exact/compact) [exact]: ";
+    std::getline(std::cin, modeName);
+    StorageMode mode = toLower(modeName) == "compact" ? STORAGE_COMPACT : STORAGE_EXACT;
+
+    TransactionStore store(mode);
+    TransactionArray array(store);
+    TransactionList fullList(store);
+    if (!loadCSV(store, array, fullList, filename)) {
     std::cerr << "[FATAL] Failed to load data. Exiting...\n";
     return 1;  // or return from main()
 }
     std::cout << "[DEBUG] Array size after load: " << array.getSize() << "\n";
+    PartitionIndex channelPartitions = buildPartitionIndex(store, COL_PAYMENT_CHANNEL);
+    SortedIndexCache sortedIndexes(store);
+    AccountIndex accounts;
+    accounts.build(store, std::max(1u, std::thread::hardware_concurrency()));
 
     do
     {
@@ -937,41 +6105,48 @@ int main()
         switch (choice)
         {
         case 1:
+        {
+            std::string columnName;
+            std::cout << "Partition by column (payment_channel, transaction_type, merchant_category,\n"
+                      << "                     location, device_used, fraud_type) [payment_channel]: ";
+            std::getline(std::cin, columnName);
+
+            CategoricalColumn column = COL_PAYMENT_CHANNEL;
+            if (!columnName.empty() && !parseCategoricalColumn(columnName, column))
+            {
+                std::cout << "[ERROR] Unknown column: " << columnName << "\n";
+                break;
+            }
+
             std::cout << "\n-- Array Data --\n";
             array.print(20);
 
             std::cout << "\n-- Full Linked List --\n";
             fullList.print(20);
 
-            std::cout << "\n-- Card Transactions --\n";
-            cardList.print(20);
-
-            std::cout << "\n-- ACH Transactions --\n";
-            achList.print(20);
-
-            std::cout << "\n-- UPI Transactions --\n";
-            upiList.print(20);
-
-            std::cout << "\n-- Wire Transfer Transactions --\n";
-            wireList.print(20);
+            if (column == COL_PAYMENT_CHANNEL)
+                printPartitions(store, channelPartitions, 20);
+            else
+                printPartitions(store, buildPartitionIndex(store, column), 20);
             break;
+        }
         case 2:
             {
-                runSortBenchmark(array, fullList);
+                runSortBenchmark(store, array, fullList);
                 break;
             }
 
             break;
         case 3:
             std::cout << "[DEBUG] Running Option 4: Sorting now...\n";
-            array.sortByLocation();
+            reportSortReuse("Array", array.ensureSortedBy(ORDER_BY_LOCATION, &sortedIndexes), array.sortState());
             std::cout << "[DEBUG] Sort complete, printing first 20...\n";
             array.print(100);
             break;
         case 4:
         {
             std::cout << "[DEBUG] Sorting Linked List by location...\n";
-            fullList.sortByLocation();
+            reportSortReuse("Linked list", fullList.ensureSortedBy(ORDER_BY_LOCATION, &sortedIndexes), fullList.sortState());
             std::cout << "[DEBUG] Sort complete, printing first 20...\n";
             fullList.print(100);
             break;
@@ -979,20 +6154,36 @@ int main()
         case 5:
         {
             std::string type;
+            std::string method;
             std::cout << "Enter transaction type to search (array): ";
             std::getline(std::cin, type);
-            array.sortByTransactionType();
-            array.binarySearchTransactionType(type);
+            std::cout << "Search via (index/binary) [index]: ";
+            std::getline(std::cin, method);
+            if (toLower(method) == "binary")
+            {
+                reportSortReuse("Array", array.ensureSortedBy(ORDER_BY_TYPE, &sortedIndexes), array.sortState());
+                array.binarySearchTransactionType(type);
+            }
+            else
+                array.searchTransactionType(type);
 
             break;
         }
         case 6:
         {
             std::string type;
+            std::string method;
             std::cout << "Enter transaction type to search (list): ";
             std::getline(std::cin, type);
-            fullList.sortByTransactionType();
-            fullList.jumpSearchTransactionType(type);
+            std::cout << "Search via (index/skip) [index]: ";
+            std::getline(std::cin, method);
+            if (toLower(method) == "skip")
+            {
+                reportSortReuse("Linked list", fullList.ensureSortedBy(ORDER_BY_TYPE, &sortedIndexes), fullList.sortState());
+                fullList.skipSearchTransactionType(type);
+            }
+            else
+                fullList.searchTransactionType(type);
 
             break;
         }
@@ -1005,9 +6196,9 @@ int main()
             }
 
             
-            // MEMORY USAGE COMPARISON
-            size_t arrayMemory = estimateArrayMemory(array);
-            size_t listMemory = estimateListMemory(fullList);
+            // MEMORY USAGE COMPARISON (container overhead; both share the store's records)
+            size_t arrayMemory = array.memoryUsage();
+            size_t listMemory = fullList.memoryUsage();
 
             std::cout << "\n=== PERFORMANCE COMPARISON ===\n";
 
@@ -1019,6 +6210,9 @@ int main()
             std::cout << "Sorting Time (location)               : " << benchmark.listSortTime << " ns\n";
             std::cout << "Searching Time (transaction type)     : " << benchmark.listSearchTime << " ns\n\n";
 
+            std::cout << "[ HASH INDEX ]\n";
+            std::cout << "Searching Time (transaction type)     : " << benchmark.indexSearchTime << " ns\n\n";
+
             std::cout << ">>> SORTING: ";
                 if (benchmark.arraySortTime < benchmark.listSortTime)
                     std::cout << "Array is faster for sorting by location.\n";
@@ -1047,19 +6241,120 @@ int main()
                 else
             std::cout << "Both use equal memory.\n";
 
+            printMemoryUsage(store, array, fullList, channelPartitions, sortedIndexes, accounts);
+
 
 
             break;
         }
         case 8:
         {
-            exportCustomJSON(array, fullList);
+            exportCustomJSON(store, array, fullList, sortedIndexes);
             break;
         }
 
 
 
         case 9:
+        {
+            runZoneMapQuery(store);
+            break;
+        }
+
+        case 10:
+        {
+            runListSortBenchmark(store);
+            break;
+        }
+
+        case 11:
+        {
+            runTypeSortBenchmark(store);
+            break;
+        }
+
+        case 12:
+        {
+            runRadixSortBenchmark(store);
+            break;
+        }
+
+        case 13:
+        {
+            runParallelSortBenchmark(store);
+            break;
+        }
+
+        case 14:
+        {
+            runIntroSortBenchmark(store);
+            break;
+        }
+
+        case 15:
+        {
+            runMultiKeySort(array, fullList);
+            break;
+        }
+
+        case 16:
+        {
+            runExternalSort(filename);
+            break;
+        }
+
+        case 17:
+        {
+            runTopKQuery(store);
+            break;
+        }
+
+        case 18:
+        {
+            runAdaptiveSortBenchmark(store);
+            break;
+        }
+
+        case 19:
+        {
+            runPrefixSortBenchmark(store);
+            break;
+        }
+
+        case 20:
+        {
+            runQuery(store, accounts);
+            break;
+        }
+
+        case 21:
+        {
+            runRangeIndexQuery(store);
+            break;
+        }
+
+        case 22:
+        {
+            runAccountHistory(store, accounts);
+            break;
+        }
+
+        case 23:
+        {
+            std::string ids;
+            std::cout << "Transaction ids (comma or space separated): ";
+            std::getline(std::cin, ids);
+            auto start = std::chrono::high_resolution_clock::now();
+            std::vector<uint32_t> rowIds = lookupTransactionIds(store, ids);
+            auto end = std::chrono::high_resolution_clock::now();
+            std::cout << "[INFO] Found " << rowIds.size() << " transactions in "
+                      << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us\n";
+            for (uint32_t rowId : rowIds)
+                printRow(store, store.row(rowId));
+            break;
+        }
+
+        case 0:
         {
             std::cout << "Exiting program .\n";
             break;
@@ -1069,7 +6364,7 @@ int main()
         default:
             std::cout << "Invalid choice.\n";
         }
-    } while (choice != 9);
+    } while (choice != 0);
 
     return 0;
 }